@@ -0,0 +1,108 @@
+// Deterministic corpora for the benchmarks, generated rather than checked in
+// so that sizes can be tuned freely.
+
+export interface Corpus {
+  name: string;
+  small: string;
+  large: string;
+  // A pattern with captures that matches a fair number of times in the corpus
+  pattern: string;
+  flags: string;
+  // A word that occurs in the corpus, for literal searches
+  literal: string;
+}
+
+// mulberry32
+function createRandom(seed: number): (n: number) => number {
+  return (n) => {
+    seed = (seed + 0x6d2b79f5) | 0;
+    let t = seed;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return Math.floor((((t ^ (t >>> 14)) >>> 0) / 4294967296) * n);
+  };
+}
+
+function generate(size: number, seed: number, next: (random: (n: number) => number) => string): string {
+  const random = createRandom(seed);
+  const parts: string[] = [];
+  let length = 0;
+  while (length < size) {
+    const part = next(random);
+    parts.push(part);
+    length += part.length;
+  }
+  return parts.join("");
+}
+
+function pick<T>(random: (n: number) => number, items: readonly T[]): T {
+  return items[random(items.length)];
+}
+
+const levels = ["DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"] as const;
+const methods = ["GET", "GET", "POST", "PUT", "DELETE"] as const;
+const routes = ["/api/v1/items", "/api/v1/users", "/health", "/static/app.js", "/api/v2/search"] as const;
+
+function logLine(random: (n: number) => number): string {
+  const time = new Date(Date.UTC(2025, 7, 28, 0, 0, 0, random(86_400_000))).toISOString();
+  const status = pick(random, [200, 200, 200, 201, 304, 404, 500]);
+  return (
+    `${time} ${pick(random, levels)} [worker-${random(16)}] ` +
+    `${pick(random, methods)} ${pick(random, routes)}/${random(100_000)} ${status} ${random(2000)}ms\n`
+  );
+}
+
+const cjkSentences = [
+  "東京都の天気は晴れです。",
+  "今日は会議が三時から始まります。",
+  "这个项目的性能需要进一步优化。",
+  "请在星期五之前提交报告。",
+  "서울의 인구는 약 천만 명입니다。",
+  "新しいバージョンがリリースされました。",
+] as const;
+
+function cjkSentence(random: (n: number) => number): string {
+  return pick(random, cjkSentences) + (random(8) === 0 ? "\n" : "");
+}
+
+const astralWords = ["😀", "🎉🎉", "𝒜𝒷𝒸", "🚀 launch", "𠀋𠂉", "👩‍💻 code", "plain", "𝔘𝔫𝔦𝔠𝔬𝔡𝔢"] as const;
+
+function astralWord(random: (n: number) => number): string {
+  return pick(random, astralWords) + pick(random, [" ", " ", ", ", "\n"]);
+}
+
+const smallSize = 100;
+const largeSize = 1 << 20;
+
+export const corpora: readonly Corpus[] = [
+  {
+    name: "ASCII logs",
+    small: generate(smallSize, 1, logLine),
+    large: generate(largeSize, 1, logLine),
+    pattern: "(\\d{4}-\\d\\d-\\d\\d)T\\S+ (WARN|ERROR) \\[([\\w-]+)\\]",
+    flags: "",
+    literal: "ERROR",
+  },
+  {
+    name: "CJK text",
+    small: generate(smallSize, 2, cjkSentence),
+    large: generate(largeSize, 2, cjkSentence),
+    pattern: "([\\u4e00-\\u9fff]+)(は|の)",
+    flags: "",
+    literal: "会議",
+  },
+  {
+    name: "astral characters",
+    small: generate(smallSize, 3, astralWord),
+    large: generate(largeSize, 3, astralWord),
+    pattern: "([😀-🙏🚀]+)|(𝒜\\S*)",
+    flags: "u",
+    literal: "launch",
+  },
+];
+
+export const paths: readonly string[] = generate(1_000_000, 4, (random) => {
+  const dirs = ["src", "lib", "test", "node_modules/pkg", "dist", "docs"];
+  const exts = [".ts", ".js", ".mts", ".json", ".md", ".d.ts"];
+  return `${pick(random, dirs)}/${"abcdefgh"[random(8)]}${random(1000)}/file${random(100)}${pick(random, exts)}\n`;
+}).split("\n").slice(0, -1);
@@ -0,0 +1,267 @@
+// Times raw PCRE2 calls on the inputs the JS overhead harness
+// (bench/overhead.mts) writes, so that the harness can subtract them from
+// the time of the matching addon methods. Flags are applied the same way the
+// addon does, including its JavaScript compatibility options.
+//
+// Usage: pcre2-bench <operation> <flags> <pattern-file> <subject-file> [replacement-file]
+//
+// Files hold UTF-16LE text. Operations are compile, match, match-all, split
+// and substitute. Prints a single JSON object with the mean time
+// per call.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <pcre2.h>
+
+namespace {
+    const double kMinSeconds = 0.5;
+
+    std::u16string ReadFile(const char *path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "pcre2-bench: cannot read %s\n", path);
+            exit(1);
+        }
+
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::u16string text(bytes.size() / 2, u'\0');
+        for (size_t i = 0; i < text.size(); i++) {
+            text[i] = static_cast<char16_t>(
+                static_cast<uint8_t>(bytes[2*i]) | (static_cast<uint8_t>(bytes[2*i+1]) << 8));
+        }
+        return text;
+    }
+
+    struct Flags {
+        uint32_t options = 0;
+        uint32_t extraOptions = 0;
+        bool global = false;
+        bool pcre2 = false;
+    };
+
+    // The subset of PCRE2::ParseFlags the benchmarks use
+    Flags ParseFlags(const std::string &flags) {
+        Flags parsed;
+        for (char c : flags) {
+            switch (c) {
+                case 'g': parsed.global = true; break;
+                case 'i': parsed.options |= PCRE2_CASELESS; break;
+                case 'm': parsed.options |= PCRE2_MULTILINE; break;
+                case 's': parsed.options |= PCRE2_DOTALL; break;
+                case 'u': parsed.options |= PCRE2_UTF; break;
+                case 'p': parsed.pcre2 = true; break;
+                default:
+                    fprintf(stderr, "pcre2-bench: unsupported flag '%c'\n", c);
+                    exit(1);
+            }
+        }
+
+        if (!parsed.pcre2) {
+            parsed.options |= PCRE2_ALT_BSUX | PCRE2_DOLLAR_ENDONLY | PCRE2_MATCH_UNSET_BACKREF;
+            parsed.extraOptions |= PCRE2_EXTRA_ALT_BSUX;
+        }
+        return parsed;
+    }
+
+    pcre2_code *Compile(const std::u16string &pattern, const Flags &flags) {
+        pcre2_compile_context *compileContext = pcre2_compile_context_create(nullptr);
+        pcre2_set_newline(compileContext, PCRE2_NEWLINE_ANYCRLF);
+        pcre2_set_compile_extra_options(compileContext, flags.extraOptions);
+
+        int errorCode;
+        PCRE2_SIZE errorOffset;
+        pcre2_code *re = pcre2_compile(
+            reinterpret_cast<PCRE2_SPTR>(pattern.c_str()),
+            pattern.size(),
+            flags.options,
+            &errorCode,
+            &errorOffset,
+            compileContext
+        );
+        pcre2_compile_context_free(compileContext);
+
+        if (re == nullptr) {
+            fprintf(stderr, "pcre2-bench: compilation failed at offset %zu (%d)\n", errorOffset, errorCode);
+            exit(1);
+        }
+        return re;
+    }
+
+    size_t AdvanceStringIndex(const std::u16string &subject, size_t index, const Flags &flags) {
+        if ((flags.options & PCRE2_UTF) && index + 1 < subject.size() &&
+            subject[index] >= 0xD800 && subject[index] <= 0xDBFF &&
+            subject[index + 1] >= 0xDC00 && subject[index + 1] <= 0xDFFF)
+        {
+            return index + 2;
+        }
+        return index + 1;
+    }
+
+    // Global matching the way the addon's match does it, so the number of
+    // pcre2_match calls is the same
+    size_t MatchAll(pcre2_code *re, pcre2_match_data *matchData, const std::u16string &subject, const Flags &flags) {
+        size_t matches = 0;
+        size_t offset = 0;
+        uint32_t options = 0;
+        while (offset <= subject.size()) {
+            int rc = pcre2_match(
+                re, reinterpret_cast<PCRE2_SPTR>(subject.c_str()), subject.size(), offset, options, matchData, nullptr);
+            if (rc < 0) {
+                if (options == 0) {
+                    break;
+                }
+                options = 0;
+                offset = AdvanceStringIndex(subject, offset, flags);
+                continue;
+            }
+
+            matches++;
+            PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(matchData);
+            offset = ovector[1];
+            options = 0;
+            if (ovector[0] == ovector[1]) {
+                if (offset == subject.size()) {
+                    break;
+                }
+                if (flags.pcre2) {
+                    options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+                } else {
+                    offset = AdvanceStringIndex(subject, offset, flags);
+                }
+            }
+        }
+        return matches;
+    }
+
+    // Splitting the way the addon's split does it: the pattern is compiled
+    // again as sticky for every call, JIT compiled by its first match, and
+    // matched anchored at every position until it matches
+    size_t Split(const std::u16string &pattern, const std::u16string &subject, const Flags &flags) {
+        pcre2_code *re = Compile(pattern, flags);
+        pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+        pcre2_match_data *matchData = pcre2_match_data_create_from_pattern(re, nullptr);
+
+        size_t pieces = 0;
+        size_t p = 0;
+        size_t q = p;
+        while (q < subject.size()) {
+            int rc = pcre2_match(
+                re, reinterpret_cast<PCRE2_SPTR>(subject.c_str()), subject.size(), q, PCRE2_ANCHORED, matchData,
+                nullptr);
+            size_t e = rc < 0 ? p : pcre2_get_ovector_pointer(matchData)[1];
+            if (e == p) {
+                q = AdvanceStringIndex(subject, q, flags);
+            } else {
+                pieces++;
+                p = e;
+                q = p;
+            }
+        }
+
+        pcre2_match_data_free(matchData);
+        pcre2_code_free(re);
+        return pieces + 1;
+    }
+
+    template<typename Fn>
+    void Run(const char *operation, Fn fn) {
+        using Clock = std::chrono::steady_clock;
+
+        // Warm up, and find how many calls fit in a tenth of the time
+        uint64_t batch = 1;
+        while (true) {
+            Clock::time_point start = Clock::now();
+            for (uint64_t i = 0; i < batch; i++) {
+                fn();
+            }
+            if (std::chrono::duration<double>(Clock::now() - start).count() >= kMinSeconds / 10) {
+                break;
+            }
+            batch *= 2;
+        }
+
+        uint64_t calls = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed;
+        do {
+            for (uint64_t i = 0; i < batch; i++) {
+                fn();
+            }
+            calls += batch;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < kMinSeconds);
+
+        printf("{\"operation\":\"%s\",\"calls\":%llu,\"nsPerCall\":%.1f}\n",
+            operation, static_cast<unsigned long long>(calls), elapsed * 1e9 / calls);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: pcre2-bench <operation> <flags> <pattern-file> <subject-file> [replacement-file]\n");
+        return 1;
+    }
+
+    const char *operation = argv[1];
+    Flags flags = ParseFlags(argv[2]);
+    std::u16string pattern = ReadFile(argv[3]);
+    std::u16string subject = ReadFile(argv[4]);
+    std::u16string replacement = argc > 5 ? ReadFile(argv[5]) : std::u16string();
+
+    if (strcmp(operation, "compile") == 0) {
+        Run(operation, [&]() {
+            pcre2_code_free(Compile(pattern, flags));
+        });
+        return 0;
+    }
+
+    if (strcmp(operation, "split") == 0) {
+        Run(operation, [&]() {
+            Split(pattern, subject, flags);
+        });
+        return 0;
+    }
+
+    pcre2_code *re = Compile(pattern, flags);
+    pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+    pcre2_match_data *matchData = pcre2_match_data_create_from_pattern(re, nullptr);
+
+    if (strcmp(operation, "match") == 0) {
+        Run(operation, [&]() {
+            pcre2_match(re, reinterpret_cast<PCRE2_SPTR>(subject.c_str()), subject.size(), 0, 0, matchData, nullptr);
+        });
+    } else if (strcmp(operation, "match-all") == 0) {
+        Run(operation, [&]() {
+            MatchAll(re, matchData, subject, flags);
+        });
+    } else if (strcmp(operation, "substitute") == 0) {
+        std::vector<PCRE2_UCHAR> output(subject.size() + subject.size() / 2);
+        uint32_t options = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH | (flags.global ? PCRE2_SUBSTITUTE_GLOBAL : 0);
+        Run(operation, [&]() {
+            while (true) {
+                PCRE2_SIZE outputLength = output.size();
+                int rc = pcre2_substitute(
+                    re, reinterpret_cast<PCRE2_SPTR>(subject.c_str()), subject.size(), 0, options, matchData, nullptr,
+                    reinterpret_cast<PCRE2_SPTR>(replacement.c_str()), replacement.size(), output.data(), &outputLength);
+                if (rc != PCRE2_ERROR_NOMEMORY) {
+                    break;
+                }
+                output.resize(outputLength);
+            }
+        });
+    } else {
+        fprintf(stderr, "pcre2-bench: unknown operation %s\n", operation);
+        return 1;
+    }
+
+    pcre2_match_data_free(matchData);
+    pcre2_code_free(re);
+    return 0;
+}
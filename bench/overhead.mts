@@ -0,0 +1,165 @@
+// Reports how much of each addon method's time is binding overhead rather
+// than PCRE2, by timing the method here and the raw PCRE2 calls it makes in
+// the native pcre2-bench executable, on the same corpora as the vitest
+// benchmarks.
+//
+// Build the executable with `pnpm cmake-js build --CDNODE_PCRE2_BENCHMARKS=ON`,
+// then run `pnpm bench:overhead`. Set PCRE2_BENCH to use an executable from
+// another location.
+
+import { execFileSync } from "node:child_process";
+import { existsSync, mkdtempSync, rmSync, writeFileSync } from "node:fs";
+import { createRequire } from "node:module";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { corpora } from "./corpora.mts";
+
+const { PCRE2 } = createRequire(import.meta.url)("..") as typeof import("..");
+
+const minSeconds = 0.5;
+
+type Operation = "compile" | "match" | "match-all" | "split" | "substitute";
+
+interface Case {
+  method: string;
+  // The raw PCRE2 calls the method makes
+  operation: Operation;
+  pattern: string;
+  flags: string;
+  replacement?: string;
+  run: () => unknown;
+}
+
+interface Result {
+  corpus: string;
+  size: string;
+  method: string;
+  operation: Operation;
+  addonNs: number;
+  nativeNs: number;
+  overheadNs: number;
+  overheadPercent: number;
+}
+
+function findExecutable(): string {
+  if (process.env.PCRE2_BENCH) {
+    return process.env.PCRE2_BENCH;
+  }
+
+  const name = process.platform === "win32" ? "pcre2-bench.exe" : "pcre2-bench";
+  for (const dir of ["build/Release", "build", "build/Release/Release"]) {
+    const path = join(import.meta.dirname, "..", dir, name);
+    if (existsSync(path)) {
+      return path;
+    }
+  }
+
+  throw new Error("pcre2-bench not found, build it with `pnpm cmake-js build --CDNODE_PCRE2_BENCHMARKS=ON`");
+}
+
+function time(fn: () => unknown): number {
+  let batch = 1;
+  for (;;) {
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < batch; i++) {
+      fn();
+    }
+    if (Number(process.hrtime.bigint() - start) >= (minSeconds / 10) * 1e9) {
+      break;
+    }
+    batch *= 2;
+  }
+
+  let calls = 0;
+  let elapsed = 0;
+  const start = process.hrtime.bigint();
+  do {
+    for (let i = 0; i < batch; i++) {
+      fn();
+    }
+    calls += batch;
+    elapsed = Number(process.hrtime.bigint() - start);
+  } while (elapsed < minSeconds * 1e9);
+
+  return elapsed / calls;
+}
+
+function writeUtf16(path: string, text: string): string {
+  writeFileSync(path, Buffer.from(text, "utf16le"));
+  return path;
+}
+
+function cases(pattern: string, flags: string, subject: string): Case[] {
+  const re = new PCRE2(pattern, flags);
+  const globalRe = new PCRE2(pattern, flags + "g");
+  const splitRe = new PCRE2("\\s+", flags);
+  return [
+    { method: "exec", operation: "match", pattern, flags, run: () => re.exec(subject) },
+    { method: "test", operation: "match", pattern, flags, run: () => re.test(subject) },
+    { method: "global match", operation: "match-all", pattern, flags, run: () => subject.match(globalRe) },
+    { method: "split", operation: "split", pattern: "\\s+", flags, run: () => subject.split(splitRe) },
+    {
+      method: "replace with a string",
+      operation: "substitute",
+      pattern,
+      flags: flags + "g",
+      replacement: "<$1>",
+      run: () => subject.replace(globalRe, "<$1>"),
+    },
+  ];
+}
+
+const executable = findExecutable();
+const dir = mkdtempSync(join(tmpdir(), "pcre2-bench-"));
+const results: Result[] = [];
+
+try {
+  for (const corpus of corpora) {
+    const constructorCase: Case = {
+      method: "constructor",
+      operation: "compile",
+      pattern: corpus.pattern,
+      flags: corpus.flags,
+      run: () => new PCRE2(corpus.pattern, corpus.flags),
+    };
+
+    for (const size of ["small", "large"] as const) {
+      const subject = corpus[size];
+      const subjectFile = writeUtf16(join(dir, "subject"), subject);
+      const sizeCases = cases(corpus.pattern, corpus.flags, subject);
+      if (size === "small") {
+        sizeCases.unshift(constructorCase);
+      }
+
+      for (const benchCase of sizeCases) {
+        const args = [
+          benchCase.operation,
+          benchCase.flags,
+          writeUtf16(join(dir, "pattern"), benchCase.pattern),
+          subjectFile,
+        ];
+        if (benchCase.replacement !== undefined) {
+          args.push(writeUtf16(join(dir, "replacement"), benchCase.replacement));
+        }
+
+        const native = JSON.parse(execFileSync(executable, args, { encoding: "utf8" })) as { nsPerCall: number };
+        const addonNs = time(benchCase.run);
+        results.push({
+          corpus: corpus.name,
+          size,
+          method: benchCase.method,
+          operation: benchCase.operation,
+          addonNs: Math.round(addonNs),
+          nativeNs: Math.round(native.nsPerCall),
+          overheadNs: Math.round(addonNs - native.nsPerCall),
+          overheadPercent: Math.round(((addonNs - native.nsPerCall) / addonNs) * 100),
+        });
+      }
+    }
+  }
+} finally {
+  rmSync(dir, { recursive: true, force: true });
+}
+
+console.table(results);
+writeFileSync("bench-overhead.json", JSON.stringify(results, null, 2) + "\n");
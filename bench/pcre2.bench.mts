@@ -0,0 +1,94 @@
+import { bench, describe } from "vitest";
+import { PCRE2 } from "..";
+import { corpora, paths } from "./corpora.mts";
+
+// Each describe compares PCRE2 against RegExp on the same input, run with
+// `pnpm bench`, which also writes the results to bench.json for comparing
+// releases with `vitest bench --compare`.
+
+type Engine = "PCRE2" | "RegExp";
+
+function create(engine: Engine, pattern: string, flags: string): RegExp {
+  // PCRE2 implements the RegExp interface the string methods use
+  return engine === "PCRE2" ? (new PCRE2(pattern, flags) as unknown as RegExp) : new RegExp(pattern, flags);
+}
+
+function compare(name: string, setup: (engine: Engine) => () => unknown): void {
+  describe(name, () => {
+    for (const engine of ["PCRE2", "RegExp"] as const) {
+      const run = setup(engine);
+      bench(engine, () => {
+        run();
+      });
+    }
+  });
+}
+
+for (const corpus of corpora) {
+  const { pattern, flags, literal } = corpus;
+
+  compare(`${corpus.name}: construction`, (engine) => () => create(engine, pattern, flags));
+
+  compare(`${corpus.name}: first call`, (engine) => () => create(engine, pattern, flags).test(corpus.small));
+
+  for (const size of ["small", "large"] as const) {
+    const subject = corpus[size];
+    const label = `${corpus.name} (${size})`;
+
+    compare(`${label}: exec`, (engine) => {
+      const re = create(engine, pattern, flags);
+      return () => re.exec(subject);
+    });
+
+    compare(`${label}: test`, (engine) => {
+      const re = create(engine, pattern, flags);
+      return () => re.test(subject);
+    });
+
+    compare(`${label}: search`, (engine) => {
+      const re = create(engine, literal, flags);
+      return () => subject.search(re);
+    });
+
+    compare(`${label}: global match`, (engine) => {
+      const re = create(engine, pattern, flags + "g");
+      return () => subject.match(re);
+    });
+
+    compare(`${label}: matchAll`, (engine) => {
+      const re = create(engine, pattern, flags + "g");
+      return () => {
+        let count = 0;
+        for (const match of subject.matchAll(re)) {
+          count += match.length;
+        }
+        return count;
+      };
+    });
+
+    compare(`${label}: split`, (engine) => {
+      const re = create(engine, "\\s+", flags);
+      return () => subject.split(re);
+    });
+
+    compare(`${label}: replace with a string`, (engine) => {
+      const re = create(engine, pattern, flags + "g");
+      return () => subject.replace(re, "<$1>");
+    });
+
+    compare(`${label}: replace with a callback`, (engine) => {
+      const re = create(engine, pattern, flags + "g");
+      return () => subject.replace(re, (match: string, first: string | undefined) => first ?? match);
+    });
+  }
+}
+
+compare("paths: glob filtering", (engine) => {
+  if (engine === "PCRE2") {
+    const re = PCRE2.fromGlob("src/**/*.ts");
+    return () => re.filterPaths(paths as string[]);
+  }
+
+  const re = /^src\/(?:.*\/)?[^/]*\.ts$/;
+  return () => paths.filter((path) => re.test(path));
+});
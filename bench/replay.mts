@@ -0,0 +1,187 @@
+// Replays a trace recorded with PCRE2.startRecording under different
+// configurations, and reports the latency distribution of each pattern:
+//
+//   pnpm replay trace.bin [--configs jit,interpreter,regexp] [--iterations 5]
+//
+// The configurations are:
+// * recorded - The durations in the trace itself, which only time the
+//   pcre2_match or pcre2_substitute call.
+// * jit - PCRE2 with JIT compilation, as by default.
+// * interpreter - PCRE2 without JIT compilation.
+// * regexp - The native RegExp, for patterns it can compile.
+//
+// Replayed calls are timed through the whole exec or replace call, including
+// building its result, so the measured column tells them apart from the
+// recorded ones. Calls recorded with only the length of their subject can't
+// be replayed, nor can substitutions with RegExp since PCRE2 replacement
+// strings have a different syntax, and both are counted as skipped. The
+// results are written to replay.json.
+
+import { readFileSync, writeFileSync } from "node:fs";
+import { createRequire } from "node:module";
+import { parseArgs } from "node:util";
+import { PCRE2_ANCHORED, PCRE2_SUBSTITUTE_GLOBAL, readTrace, type TraceMatch, type TracePattern } from "./trace.mts";
+
+const { PCRE2 } = createRequire(import.meta.url)("..") as typeof import("..");
+
+type Config = "recorded" | "jit" | "interpreter" | "regexp";
+
+interface Result {
+  pattern: string;
+  flags: string;
+  config: Config;
+  // What the durations time
+  measured: "pcre2 call" | "api call";
+  calls: number;
+  skipped: number;
+  meanUs: number;
+  p50Us: number;
+  p90Us: number;
+  p99Us: number;
+  maxUs: number;
+}
+
+// Matches a recorded call, along with the flags it needs for it
+type Runner = (match: TraceMatch) => unknown;
+
+const { values, positionals } = parseArgs({
+  allowPositionals: true,
+  options: {
+    configs: { type: "string", default: "recorded,jit,interpreter,regexp" },
+    iterations: { type: "string", default: "5" },
+    output: { type: "string", default: "replay.json" },
+  },
+});
+
+if (positionals.length !== 1) {
+  console.error("Usage: replay.mts <trace> [--configs jit,interpreter,regexp] [--iterations 5] [--output replay.json]");
+  process.exit(1);
+}
+
+const trace = readTrace(readFileSync(positionals[0]));
+const configs = values.configs.split(",") as Config[];
+const iterations = Number(values.iterations);
+
+// Each call is replayed through the public API: a start offset as the
+// lastIndex of a global or sticky pattern, and PCRE2_ANCHORED as sticky
+function matchFlags(flags: string, match: TraceMatch) {
+  const base = flags.replace(/[gy]/g, "");
+  if (match.kind === "substitute") {
+    return match.options & PCRE2_SUBSTITUTE_GLOBAL ? base + "g" : base;
+  }
+  return match.options & PCRE2_ANCHORED ? base + "y" : base + "g";
+}
+
+function runner(config: Config, { pattern, flags }: TracePattern): Runner | undefined {
+  const cache = new Map<string, RegExp | InstanceType<typeof PCRE2>>();
+  let create: (flags: string) => RegExp | InstanceType<typeof PCRE2>;
+  switch (config) {
+    case "jit":
+      create = (flags) => new PCRE2(pattern, flags);
+      break;
+    case "interpreter":
+      create = (flags) => new PCRE2(pattern, flags, { jit: false });
+      break;
+    case "regexp":
+      create = (flags) => new RegExp(pattern, flags);
+      try {
+        create(flags.replace(/[gy]/g, ""));
+      } catch {
+        return undefined;
+      }
+      break;
+    default:
+      return undefined;
+  }
+
+  return (match) => {
+    const callFlags = matchFlags(flags, match);
+    let re = cache.get(callFlags);
+    if (!re) {
+      re = create(callFlags);
+      cache.set(callFlags, re);
+    }
+
+    const subject = match.subject!;
+    if (match.kind === "substitute") {
+      return subject.replace(re as RegExp, match.replacement!);
+    }
+    re.lastIndex = match.startOffset;
+    return re.exec(subject);
+  };
+}
+
+function percentile(sorted: number[], p: number) {
+  return sorted[Math.min(sorted.length - 1, Math.floor((sorted.length * p) / 100))];
+}
+
+function summarize(pattern: TracePattern, config: Config, durationsNs: number[], skipped: number): Result {
+  const sorted = [...durationsNs].sort((a, b) => a - b);
+  const us = (ns: number | undefined) => Math.round((ns ?? 0) / 10) / 100;
+  return {
+    pattern: pattern.pattern,
+    flags: pattern.flags,
+    config,
+    measured: config === "recorded" ? "pcre2 call" : "api call",
+    calls: sorted.length,
+    skipped,
+    meanUs: us(sorted.reduce((sum, ns) => sum + ns, 0) / (sorted.length || 1)),
+    p50Us: us(percentile(sorted, 50)),
+    p90Us: us(percentile(sorted, 90)),
+    p99Us: us(percentile(sorted, 99)),
+    maxUs: us(sorted.at(-1)),
+  };
+}
+
+const matchesByPattern = new Map<number, TraceMatch[]>();
+for (const record of trace.records) {
+  if (record.type === "match") {
+    const matches = matchesByPattern.get(record.patternId) ?? [];
+    matches.push(record);
+    matchesByPattern.set(record.patternId, matches);
+  }
+}
+
+const results: Result[] = [];
+for (const [patternId, matches] of matchesByPattern) {
+  const pattern = trace.patterns.get(patternId)!;
+
+  for (const config of configs) {
+    if (config === "recorded") {
+      results.push(summarize(pattern, config, matches.map((match) => match.durationNs), 0));
+      continue;
+    }
+
+    const run = runner(config, pattern);
+    if (!run) {
+      results.push(summarize(pattern, config, [], matches.length));
+      continue;
+    }
+
+    const replayable = matches.filter(
+      (match) => match.subject !== undefined && (config !== "regexp" || match.kind !== "substitute"),
+    );
+    const skipped = matches.length - replayable.length;
+
+    // A warm up pass compiles each variant of the pattern, and JIT compiles it
+    for (const match of replayable) {
+      run(match);
+    }
+
+    // The median of the iterations of each call
+    const durationsNs = replayable.map((match) => {
+      const samples: number[] = [];
+      for (let i = 0; i < iterations; i++) {
+        const start = process.hrtime.bigint();
+        run(match);
+        samples.push(Number(process.hrtime.bigint() - start));
+      }
+      return samples.sort((a, b) => a - b)[Math.floor(samples.length / 2)];
+    });
+    results.push(summarize(pattern, config, durationsNs, skipped));
+  }
+}
+
+console.log(`Trace with ${trace.patterns.size} patterns, subjects: ${trace.subjects}`);
+console.table(results);
+writeFileSync(values.output, JSON.stringify(results, null, 2) + "\n");
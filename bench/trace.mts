@@ -0,0 +1,106 @@
+// Reads the binary traces written by PCRE2.startRecording, see
+// src/MatchRecorder.h for the format.
+
+export type SubjectsMode = "length" | "redacted" | "full";
+
+export interface TracePattern {
+  id: number;
+  pattern: string;
+  flags: string;
+}
+
+export interface TraceCompile {
+  type: "compile";
+  patternId: number;
+  durationNs: number;
+}
+
+export interface TraceMatch {
+  type: "match";
+  patternId: number;
+  kind: "match" | "substitute";
+  /** The PCRE2 options of the call, such as PCRE2_ANCHORED. */
+  options: number;
+  startOffset: number;
+  subjectLength: number;
+  returnCode: number;
+  jit: boolean;
+  durationNs: number;
+  /** Undefined when only the length was recorded. */
+  subject?: string;
+  replacement?: string;
+}
+
+export interface Trace {
+  subjects: SubjectsMode;
+  patterns: Map<number, TracePattern>;
+  records: (TraceCompile | TraceMatch)[];
+}
+
+export const PCRE2_ANCHORED = 0x80000000;
+export const PCRE2_SUBSTITUTE_GLOBAL = 0x00000100;
+
+const subjectsModes: SubjectsMode[] = ["length", "redacted", "full"];
+
+export function readTrace(buffer: Buffer): Trace {
+  if (buffer.toString("latin1", 0, 8) !== "PCRE2TRC") {
+    throw new Error("Not a PCRE2 trace");
+  }
+
+  let offset = 8;
+  const u8 = () => buffer.readUInt8((offset += 1) - 1);
+  const u32 = () => buffer.readUInt32LE((offset += 4) - 4);
+  const i32 = () => buffer.readInt32LE((offset += 4) - 4);
+  const u64 = () => Number(buffer.readBigUInt64LE((offset += 8) - 8));
+  const utf16 = (length: number) => buffer.toString("utf16le", offset, (offset += length * 2));
+
+  const version = u32();
+  if (version !== 1) {
+    throw new Error(`Unsupported trace version ${version}`);
+  }
+  const subjects = subjectsModes[u32()];
+
+  const patterns = new Map<number, TracePattern>();
+  const records: (TraceCompile | TraceMatch)[] = [];
+  while (offset < buffer.length) {
+    const type = u8();
+    switch (type) {
+      case 1: {
+        const id = u32();
+        const flagsLength = u32();
+        const flags = buffer.toString("utf8", offset, (offset += flagsLength));
+        const pattern = utf16(u32());
+        patterns.set(id, { id, pattern, flags });
+        break;
+      }
+      case 2:
+        records.push({ type: "compile", patternId: u32(), durationNs: u64() });
+        break;
+      case 3: {
+        const match: TraceMatch = {
+          type: "match",
+          patternId: u32(),
+          kind: u8() === 1 ? "substitute" : "match",
+          options: u32(),
+          startOffset: u32(),
+          subjectLength: u32(),
+          returnCode: i32(),
+          jit: u8() === 1,
+          durationNs: u64(),
+        };
+        if (subjects !== "length") {
+          match.subject = utf16(match.subjectLength);
+        }
+        if (match.kind === "substitute") {
+          match.replacement = utf16(u32());
+        }
+        records.push(match);
+        break;
+      }
+      default:
+        throw new Error(`Unknown trace record type ${type} at offset ${offset - 1}`);
+    }
+  }
+
+  return { subjects, patterns, records };
+}
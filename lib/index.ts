@@ -1,17 +1,241 @@
 import bindings from "bindings";
+import { type Channel, type ChannelListener, channel } from "node:diagnostics_channel";
 
 declare namespace Addon {
+  interface PCRE2Options {
+    /**
+     * Borrow match data from a pool shared by all instances during each call,
+     * instead of keeping match data per instance.
+     */
+    pooledMatchData?: boolean;
+    /**
+     * Release the match data heap frames after a call when they grew larger
+     * than this many bytes.
+     */
+    heapFramesLimit?: number;
+    /** Collect runtime statistics, see `stats` and `PCRE2.getStats`. */
+    stats?: boolean;
+    /** Time one in every this many calls (Defaults to 16). */
+    statsSampleInterval?: number;
+    /**
+     * What to do when `PCRE2.analyze` finds a risk of catastrophic
+     * backtracking, reject the pattern, or apply a strict match limit.
+     */
+    redos?: "reject" | "limit";
+    /** The PCRE2 match limit, see `pcre2_set_match_limit`. */
+    matchLimit?: number;
+    /** The default `timeoutMs` of calls. */
+    timeoutMs?: number;
+    /**
+     * Return long captures as external strings over the subject instead of
+     * copies.
+     */
+    externalStrings?: boolean;
+    /** JIT compile the pattern on its first call (Defaults to `true`). */
+    jit?: boolean;
+    /** Cache the results of up to this many subjects, see `matchCache`. */
+    matchCache?: number;
+    /** Longest subject to cache results for (Defaults to 256). */
+    matchCacheMaxSubjectLength?: number;
+  }
+
+  interface MatchOptions {
+    /**
+     * Throw an error with code `ERR_PCRE2_TIMEOUT` when the call takes longer
+     * than this many milliseconds.
+     */
+    timeoutMs?: number;
+  }
+
+  type RedosRisk = "none" | "polynomial" | "exponential";
+
+  interface RedosIssue {
+    risk: RedosRisk;
+    kind: "nestedQuantifier" | "overlappingAlternation" | "adjacentQuantifiers";
+    start: number;
+    end: number;
+    source: string;
+  }
+
+  interface PatternAnalysis {
+    risk: RedosRisk;
+    issues: RedosIssue[];
+  }
+
+  interface ProfileItem {
+    offset: number;
+    length: number;
+    item: string;
+    visits: number;
+    backtracks: number;
+  }
+
+  interface ProfileReport {
+    calls: number;
+    attempts: number;
+    items: ProfileItem[];
+  }
+
+  interface PCRE2Stats {
+    source: string;
+    flags: string;
+    calls: number;
+    matches: number;
+    noMatches: number;
+    errors: number;
+    sampledCalls: number;
+    sampledTime: number;
+    estimatedTotalTime: number;
+    maxTime: number;
+    bytesScanned: number;
+    jit: boolean;
+    jitSize: number;
+    heapFramesHighWater: number;
+  }
+
+  interface MemoryUsage {
+    pattern: number;
+    code: number;
+    jit: number;
+    matchData: number;
+    heapframes: number;
+    matchCache: number;
+    total: number;
+  }
+
+  interface MatchCacheStats {
+    capacity: number;
+    size: number;
+    hits: number;
+    misses: number;
+    /** Calls with subjects too long to cache. */
+    bypassed: number;
+    hitRate: number;
+  }
+
+  interface TotalMemoryUsage {
+    allocated: number;
+    jit: number;
+    total: number;
+  }
+
+  interface FilterParallelOptions {
+    threads?: number;
+    signal?: AbortSignal;
+  }
+
+  interface ExtractColumnsOptions extends MatchOptions {
+    /** Named groups to extract, defaults to all of them. */
+    groups?: string[];
+    /** Extract the start and end offsets of the groups instead of strings. */
+    offsets?: boolean;
+  }
+
+  interface Columns<Column> {
+    /** Number of lines. */
+    length: number;
+    /** Bit `i % 8` of byte `i >> 3` is set when line `i` matched. */
+    matched: Uint8Array;
+    columns: Record<string, Column>;
+  }
+
+  interface RecordingOptions {
+    /** Record one in every this many calls (Defaults to 1). */
+    sampleInterval?: number;
+    /**
+     * What to record of subjects, only their length (The default), a redacted
+     * copy, or the full subject.
+     */
+    subjects?: "length" | "redacted" | "full";
+  }
+
+  interface CompileManyEntry {
+    pattern: string;
+    flags?: string;
+    options?: PCRE2Options;
+  }
+
+  interface CompileManyOptions {
+    threads?: number;
+  }
+
+  interface ConvertOptions extends PCRE2Options {
+    /** Flags for the converted pattern, which is always compiled in PCRE2 mode. */
+    flags?: string;
+  }
+
+  interface GlobOptions extends ConvertOptions {
+    /** The path separator (Defaults to `/`, `\` on Windows). */
+    separator?: string;
+    /**
+     * The escape character (Defaults to `\`, `` ` `` on Windows), `null` or
+     * an empty string disables escaping.
+     */
+    escape?: string | null;
+    /** Let `*` and `?` match the separator. */
+    wildSeparator?: boolean;
+    /** Treat `**` as matching any number of path segments (Defaults to `true`). */
+    starStar?: boolean;
+  }
+
+  interface PosixOptions extends ConvertOptions {
+    /** Convert a POSIX extended regular expression rather than a basic one. */
+    extended?: boolean;
+  }
+
+  /** Published on the `pcre2:slow-match` diagnostics channel. */
+  interface SlowMatchEvent {
+    kind: "match" | "substitute";
+    source: string;
+    flags: string;
+    /** In UTF-16 code units, the subject itself is never published. */
+    subjectLength: number;
+    lastIndex: number;
+    durationMs: number;
+    jit: boolean;
+    /** The return code of `pcre2_match` or `pcre2_substitute`. */
+    returnCode: number;
+  }
+
+  interface CompileError extends Error {
+    offset?: number;
+  }
+
   class PCRE2 {
-    constructor(pattern: string, flags?: string);
+    constructor(pattern: string | RegExp | PCRE2, flags?: string, options?: PCRE2Options);
 
     static readonly [Symbol.species]: PCRE2;
 
-    exec(string: string): RegExpExecArray | null;
-    test(string: string): boolean;
+    static fromShared(id: number, options?: PCRE2Options): PCRE2;
+    static releaseShared(id: number): boolean;
+    static memoryUsage(): TotalMemoryUsage;
+    static getStats(): PCRE2Stats[];
+    static analyze(pattern: string | RegExp | PCRE2, flags?: string): PatternAnalysis;
+    static compileMany(
+      patterns: (string | CompileManyEntry)[],
+      options?: CompileManyOptions
+    ): Promise<(PCRE2 | CompileError)[]>;
+    static setSlowMatchThreshold(thresholdMs: number | undefined): void;
+    static fromGlob(glob: string, options?: GlobOptions): PCRE2;
+    static fromPosix(pattern: string, options?: PosixOptions): PCRE2;
+    static enablePerfMap(path?: string): string;
+    static disablePerfMap(): void;
+    static startRecording(path: string, options?: RecordingOptions): void;
+    /**
+     * Returns the number of records written, or undefined when not recording.
+     * Throws when writing the trace failed.
+     */
+    static stopRecording(): number | undefined;
+
+    exec(string: string, options?: MatchOptions): RegExpExecArray | null;
+    test(string: string, options?: MatchOptions): boolean;
 
     toString(): string;
 
     readonly lastIndex: number;
+    readonly stats: PCRE2Stats | undefined;
+    /** Statistics of the match cache, when enabled with the `matchCache` option. */
+    readonly matchCache: MatchCacheStats | undefined;
     readonly source: string;
     readonly flags: string;
     readonly global: boolean;
@@ -23,12 +247,28 @@ declare namespace Addon {
     readonly hasIndices: boolean;
     readonly unicodeSets: boolean;
 
-    [Symbol.match](string: string): RegExpMatchArray | null;
-    [Symbol.search](string: string): number;
-    [Symbol.split](string: string, limit?: number): string[];
+    [Symbol.match](string: string, options?: MatchOptions): RegExpMatchArray | null;
+    [Symbol.search](string: string, options?: MatchOptions): number;
+    [Symbol.split](string: string, limit?: number, options?: MatchOptions): string[];
     [Symbol.matchAll](str: string): RegExpStringIterator<RegExpMatchArray>;
-    [Symbol.replace](str: string, replacement: string): string;
-    [Symbol.replace](string: string, replacer: (substring: string, ...args: unknown[]) => string): string;
+    [Symbol.replace](str: string, replacement: string, options?: MatchOptions): string;
+    [Symbol.replace](string: string, replacer: (substring: string, ...args: unknown[]) => string, options?: MatchOptions): string;
+
+    filterParallel(strings: string[], options?: FilterParallelOptions): Promise<Uint32Array>;
+    filterPaths(paths: string[], options?: MatchOptions): Uint32Array;
+    /**
+     * Matches every line and extracts named groups by column, as strings, or
+     * as `[start, end]` pairs of offsets, -1 when the group isn't set.
+     */
+    extractColumns(
+      lines: string[] | string,
+      options: ExtractColumnsOptions & { offsets: true },
+    ): Columns<Int32Array>;
+    extractColumns(lines: string[] | string, options?: ExtractColumnsOptions): Columns<(string | undefined)[]>;
+    share(): number;
+    memoryUsage(): MemoryUsage;
+    startProfiling(): void;
+    stopProfiling(): ProfileReport | undefined;
 
     // PCRE2 extras
     readonly extended: boolean;
@@ -45,13 +285,126 @@ declare namespace Addon {
     readonly pcre2Mode: boolean;
   }
 
+  /**
+   * Matches subjects against many patterns, skipping the ones whose required
+   * literals are not in the subject.
+   */
+  class PCRE2RuleIndex {
+    constructor(rules: (string | RegExp | PCRE2)[]);
+
+    /** Number of rules in the index. */
+    readonly size: number;
+    /** Number of rules without required literals, which are run on every subject. */
+    readonly alwaysChecked: number;
+
+    /** Indices of the rules that may match, without running them. */
+    candidates(subject: string): Uint32Array;
+    /** Indices of the rules that match, tested like `filterParallel` does. */
+    match(subject: string): Uint32Array;
+  }
+
+  interface DocumentMatch {
+    start: number;
+    end: number;
+  }
+
+  interface DocumentEdit {
+    /** Index in the match list of the first removed or added match. */
+    index: number;
+    /** Matches no longer found, at their offsets before the edit. */
+    removed: DocumentMatch[];
+    /** New matches, at their offsets after the edit. */
+    added: DocumentMatch[];
+  }
+
+  /**
+   * A text and the matches of a global scan over it, kept up to date by
+   * rescanning only around edits.
+   */
+  class PCRE2Document {
+    constructor(pattern: string | RegExp | PCRE2, text: string);
+
+    readonly text: string;
+    readonly matches: DocumentMatch[];
+
+    /** Replaces `deleteCount` code units at `offset` with `insert`. */
+    edit(offset: number, deleteCount: number, insert?: string): DocumentEdit;
+  }
+
+  interface LexerRule {
+    name: string;
+    pattern: string;
+    /** Whether to leave the tokens of this rule, like whitespace, out of the result. */
+    skip?: boolean;
+  }
+
+  interface LexerOptions extends PCRE2Options {
+    /**
+     * Whether to emit runs of characters no rule matches as tokens of rule -1,
+     * instead of throwing.
+     */
+    errorRecovery?: boolean;
+  }
+
+  interface LexerTokens {
+    /** Index of the rule of each token, or -1 for unmatched characters. */
+    rules: Int32Array;
+    starts: Int32Array;
+    ends: Int32Array;
+  }
+
+  /**
+   * Splits input into tokens with an ordered list of rules, the first rule
+   * that matches at a position giving the token there.
+   */
+  class PCRE2Lexer {
+    constructor(rules: LexerRule[], flags?: string, options?: LexerOptions);
+
+    /** Names of the rules, by index. */
+    readonly names: string[];
+
+    tokenize(input: string): LexerTokens;
+  }
+
   const PCRE2_MAJOR: number;
   const PCRE2_MINOR: number;
 }
 
-export const { PCRE2, PCRE2_MAJOR, PCRE2_MINOR } = bindings(
-  "pcre2.node"
-) as typeof Addon;
+const addon = bindings("pcre2.node") as typeof Addon & {
+  setSlowMatchPublisher(publisher: (event: Addon.SlowMatchEvent) => void): void;
+  setSlowMatchSubscribed(subscribed: boolean): void;
+};
+
+export const { PCRE2, PCRE2Document, PCRE2Lexer, PCRE2RuleIndex, PCRE2_MAJOR, PCRE2_MINOR } = addon;
+
+// Published from a microtask, so that subscribers can't run in the middle of
+// the call that was slow
+const slowMatchChannel = channel("pcre2:slow-match");
+addon.setSlowMatchPublisher((event) => {
+  queueMicrotask(() => {
+    if (slowMatchChannel.hasSubscribers) {
+      slowMatchChannel.publish(event);
+    }
+  });
+});
+
+// Calls are only timed while the channel has subscribers. diagnostics_channel
+// has no subscription events, so the channel's own methods are wrapped, which
+// the module level subscribe and unsubscribe go through as well. The methods
+// are looked up on the prototype at each call since Node.js swaps it when the
+// channel gains its first subscriber or loses its last one.
+for (const method of ["subscribe", "unsubscribe"] as const) {
+  Object.defineProperty(slowMatchChannel, method, {
+    configurable: true,
+    writable: true,
+    value(this: Channel, onMessage: ChannelListener) {
+      const result: unknown = Object.getPrototypeOf(this)[method].call(this, onMessage);
+      addon.setSlowMatchSubscribed(this.hasSubscribers);
+      return result;
+    },
+  });
+}
+addon.setSlowMatchSubscribed(slowMatchChannel.hasSubscribers);
 
 type pcre2Tag = {
   (flags: string): pcre2Tag;
@@ -0,0 +1,112 @@
+#include <deque>
+#include "AhoCorasick.h"
+
+namespace {
+    const uint32_t kNoOutput = UINT32_MAX;
+}
+
+AhoCorasick::AhoCorasick(const std::vector<std::u16string> &literals)
+    : m_literalCount(literals.size())
+    , m_classes(0x10000, 0)
+    , m_classCount(1)
+{
+    // Class 0 is every code unit that is not in any literal
+    for (const std::u16string &literal : literals) {
+        for (char16_t c : literal) {
+            char16_t folded = Fold(c);
+            if (m_classes[folded] == 0) {
+                m_classes[folded] = static_cast<uint16_t>(m_classCount++);
+            }
+        }
+    }
+    for (char16_t c = 'A'; c <= 'Z'; c++) {
+        m_classes[c] = m_classes[Fold(c)];
+    }
+
+    // Build the trie, with 0 standing for a missing transition as nothing
+    // leads back to the root
+    m_next.assign(m_classCount, 0);
+    m_output.push_back(kNoOutput);
+    for (size_t i = 0; i < literals.size(); i++) {
+        uint32_t state = 0;
+        for (char16_t c : literals[i]) {
+            uint32_t &next = m_next[state * m_classCount + m_classes[c]];
+            if (next == 0) {
+                next = static_cast<uint32_t>(m_output.size());
+                m_output.push_back(kNoOutput);
+                m_next.resize(m_next.size() + m_classCount, 0);
+            }
+            // m_next may have been reallocated
+            state = m_next[state * m_classCount + m_classes[c]];
+        }
+        m_output[state] = static_cast<uint32_t>(i);
+    }
+
+    // Fill in the fail links and the missing transitions breadth first, so
+    // those of shallower states are complete when needed
+    size_t states = m_output.size();
+    m_fail.assign(states, 0);
+    m_match.assign(states, 0);
+    std::deque<uint32_t> queue;
+    for (uint32_t c = 0; c < m_classCount; c++) {
+        if (m_next[c] != 0) {
+            queue.push_back(m_next[c]);
+        }
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+
+        uint32_t fail = m_fail[state];
+        m_match[state] = m_output[state] != kNoOutput ? state : m_match[fail];
+
+        for (uint32_t c = 0; c < m_classCount; c++) {
+            uint32_t &next = m_next[state * m_classCount + c];
+            if (next != 0) {
+                m_fail[next] = m_next[fail * m_classCount + c];
+                queue.push_back(next);
+            } else {
+                next = m_next[fail * m_classCount + c];
+            }
+        }
+    }
+}
+
+void AhoCorasick::Scan(const char16_t *subject, size_t length, std::vector<uint8_t> &seen, std::vector<uint32_t> &found) const {
+    const uint32_t *next = m_next.data();
+    const uint16_t *classes = m_classes.data();
+    uint32_t classCount = m_classCount;
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < length; i++) {
+        state = next[state * classCount + classes[subject[i]]];
+
+        // Once a literal has been seen, so have the ones on its fail chain
+        for (uint32_t match = m_match[state]; match != 0; match = m_match[m_fail[match]]) {
+            uint32_t literal = m_output[match];
+            if (seen[literal]) {
+                break;
+            }
+            seen[literal] = 1;
+            found.push_back(literal);
+        }
+
+        if (found.size() == m_literalCount) {
+            return;
+        }
+    }
+}
+
+size_t AhoCorasick::LiteralCount() const {
+    return m_literalCount;
+}
+
+size_t AhoCorasick::MemorySize() const {
+    return
+        m_classes.size() * sizeof(uint16_t) +
+        (m_next.size() + m_fail.size() + m_output.size() + m_match.size()) * sizeof(uint32_t);
+}
+
+char16_t AhoCorasick::Fold(char16_t c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char16_t>(c | 0x20) : c;
+}
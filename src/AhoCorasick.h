@@ -0,0 +1,43 @@
+#ifndef NODE_PCRE2_AHO_CORASICK_H_
+#define NODE_PCRE2_AHO_CORASICK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finds which of a set of literals appear in a subject in a single pass, with
+// ASCII letters compared caselessly. The automaton is a full transition table
+// over the code units that appear in the literals, so scanning is one lookup
+// per code unit.
+class AhoCorasick {
+public:
+    // Literals must be distinct once folded, and not empty
+    explicit AhoCorasick(const std::vector<std::u16string> &literals);
+
+    AhoCorasick(const AhoCorasick&) = delete;
+    AhoCorasick& operator=(const AhoCorasick&) = delete;
+
+    // Appends the index of every literal found in the subject to found, and
+    // marks it in seen. seen must have a zero entry per literal, and found
+    // must be empty.
+    void Scan(const char16_t *subject, size_t length, std::vector<uint8_t> &seen, std::vector<uint32_t> &found) const;
+
+    size_t LiteralCount() const;
+    size_t MemorySize() const;
+
+    static char16_t Fold(char16_t c);
+
+private:
+    size_t m_literalCount;
+    std::vector<uint16_t> m_classes;
+    uint32_t m_classCount;
+    std::vector<uint32_t> m_next;
+    std::vector<uint32_t> m_fail;
+    // Index of the literal ending at each state
+    std::vector<uint32_t> m_output;
+    // The nearest state with an output among each state and its fail chain,
+    // 0 when there is none
+    std::vector<uint32_t> m_match;
+};
+
+#endif // NODE_PCRE2_AHO_CORASICK_H_
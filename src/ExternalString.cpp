@@ -0,0 +1,61 @@
+#include "ExternalString.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace {
+    const size_t kMinExternalLength = 1024;
+
+    typedef napi_status (*CreateExternalStringUtf16)(
+        napi_env env,
+        char16_t *str,
+        size_t length,
+        void (*finalize)(napi_env env, void *data, void *hint),
+        void *hint,
+        napi_value *result,
+        bool *copied);
+
+    CreateExternalStringUtf16 LookupCreateExternalStringUtf16() {
+        const char *name = "node_api_create_external_string_utf16";
+#ifdef _WIN32
+        return reinterpret_cast<CreateExternalStringUtf16>(GetProcAddress(GetModuleHandle(nullptr), name));
+#else
+        return reinterpret_cast<CreateExternalStringUtf16>(dlsym(RTLD_DEFAULT, name));
+#endif
+    }
+
+    CreateExternalStringUtf16 GetCreateExternalStringUtf16() {
+        static const CreateExternalStringUtf16 create = LookupCreateExternalStringUtf16();
+        return create;
+    }
+}
+
+Napi::String ExternalString::New(Napi::Env env, const std::shared_ptr<const std::u16string> &buffer, size_t start, size_t length) {
+    const char16_t *data = buffer->data() + start;
+
+    CreateExternalStringUtf16 create = GetCreateExternalStringUtf16();
+    if (length < kMinExternalLength || create == nullptr) {
+        return Napi::String::New(env, data, length);
+    }
+
+    // Each string holds a reference to the buffer, and V8 never writes to
+    // the characters of an external string
+    auto *hint = new std::shared_ptr<const std::u16string>(buffer);
+    napi_value result;
+    bool copied;
+    napi_status status = create(env, const_cast<char16_t*>(data), length, Finalize, hint, &result, &copied);
+    if (status != napi_ok) {
+        delete hint;
+        throw Napi::Error::New(env);
+    }
+
+    // When copied anyway, Node.js has already called the finalizer
+    return Napi::String(env, result);
+}
+
+void ExternalString::Finalize(napi_env env, void *data, void *hint) {
+    delete static_cast<std::shared_ptr<const std::u16string>*>(hint);
+}
@@ -0,0 +1,24 @@
+#ifndef NODE_PCRE2_EXTERNAL_STRING_H_
+#define NODE_PCRE2_EXTERNAL_STRING_H_
+
+#include <memory>
+#include <string>
+#include <napi.h>
+
+// Strings over part of a shared buffer, created as external strings so the
+// characters aren't copied into the V8 heap. The buffer is released once the
+// last string over it is collected.
+//
+// node_api_create_external_string_utf16 is newer than the Node-API version
+// this is built against, so it is looked up at runtime, and the characters
+// are copied when it is missing. Short strings are always copied, which is
+// cheaper than tracking them.
+class ExternalString {
+public:
+    static Napi::String New(Napi::Env env, const std::shared_ptr<const std::u16string> &buffer, size_t start, size_t length);
+
+private:
+    static void Finalize(napi_env env, void *data, void *hint);
+};
+
+#endif // NODE_PCRE2_EXTERNAL_STRING_H_
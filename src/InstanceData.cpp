@@ -1,8 +1,18 @@
 #include "InstanceData.h"
 
-InstanceData::InstanceData(Napi::Env env) {
-    compileContext = pcre2_compile_context_create(nullptr);
+namespace {
+    constexpr int64_t kExternalMemoryThreshold = 64 * 1024;
+}
+
+InstanceData::InstanceData(Napi::Env env)
+    : reportedMemory(0)
+    , jitSize(0)
+{
+    memoryTracker = new MemoryTracker();
+    compileContext = pcre2_compile_context_create(memoryTracker->GeneralContext());
     pcre2_set_newline(compileContext, PCRE2_NEWLINE_ANYCRLF);
+    matchDataPool = new MatchDataPool(memoryTracker->GeneralContext());
+    slowMatchTracer = new SlowMatchTracer();
 
     Symbol = Napi::Persistent(env.Global().Get("Symbol").As<Napi::Object>());
     RegExp = Napi::Persistent(env.Global().Get("RegExp").As<Napi::Function>());
@@ -11,5 +21,19 @@ InstanceData::InstanceData(Napi::Env env) {
 }
 
 InstanceData::~InstanceData() {
+    delete slowMatchTracer;
+    delete matchDataPool;
     pcre2_compile_context_free(compileContext);
+    memoryTracker->Release();
+}
+
+void InstanceData::AdjustExternalMemory(Napi::Env env, bool force /* = false */) {
+    int64_t allocated = static_cast<int64_t>(memoryTracker->Allocated());
+    int64_t delta = allocated - reportedMemory;
+    if (delta == 0 || (!force && delta < kExternalMemoryThreshold && delta > -kExternalMemoryThreshold)) {
+        return;
+    }
+
+    Napi::MemoryManagement::AdjustExternalMemory(env, delta);
+    reportedMemory = allocated;
 }
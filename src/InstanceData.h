@@ -1,8 +1,14 @@
 #ifndef NODE_PCRE2_INSTANCE_DATA_H_
 #define NODE_PCRE2_INSTANCE_DATA_H_
 
+#include <unordered_set>
 #include <napi.h>
 #include <pcre2.h>
+#include "MatchDataPool.h"
+#include "MemoryTracker.h"
+#include "SlowMatchTracer.h"
+
+class PatternStats;
 
 class InstanceData {
 public:
@@ -13,7 +19,17 @@ public:
     InstanceData(const InstanceData&) = delete;
     InstanceData& operator=(const InstanceData&) = delete;
 
+    // Reports changes in the memory allocated by PCRE2 to V8, batched so it
+    // isn't done on every call
+    void AdjustExternalMemory(Napi::Env env, bool force = false);
+
+    MemoryTracker *memoryTracker;
     pcre2_compile_context *compileContext;
+    MatchDataPool *matchDataPool;
+    SlowMatchTracer *slowMatchTracer;
+    int64_t reportedMemory;
+    size_t jitSize;
+    std::unordered_set<PatternStats*> patternStats;
 
     Napi::ObjectReference Symbol;
     Napi::FunctionReference RegExp;
@@ -22,6 +38,9 @@ public:
 
     Napi::FunctionReference PCRE2;
     Napi::FunctionReference PCRE2StringIterator;
+    Napi::FunctionReference PCRE2RuleIndex;
+    Napi::FunctionReference PCRE2Document;
+    Napi::FunctionReference PCRE2Lexer;
 };
 
 #endif // NODE_PCRE2_INSTANCE_DATA_H_
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <sstream>
+#include "JitPerfMap.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    const size_t kMaxPatternLength = 64;
+
+#if PCRE2_MAJOR == 10 && PCRE2_MINOR >= 42 && PCRE2_MINOR <= 45
+#define NODE_PCRE2_JIT_PERF_MAP_SUPPORTED
+    // Leading fields of pcre2_real_code and executable_functions, from
+    // pcre2_intmodedep.h and pcre2_jit_compile.c, as of the PCRE2 versions
+    // above. Other versions may lay them out differently, so they aren't read
+    // at all there.
+    struct RealCodeHead {
+        void *(*malloc)(size_t, void *);
+        void (*free)(void *, void *);
+        void *memoryData;
+        const uint8_t *tables;
+        void *executableJit;
+    };
+
+    const int kJitCompileModes = 3;
+
+    struct ExecutableFunctionsHead {
+        void *executableFuncs[kJitCompileModes];
+        void *readOnlyDataHeads[kJitCompileModes];
+        uintptr_t executableSizes[kJitCompileModes];
+    };
+
+    const char *const kModeSuffixes[kJitCompileModes] = {
+        "",
+        " [partial soft]",
+        " [partial hard]",
+    };
+#endif
+
+    void AppendUtf8(std::string &out, uint32_t c) {
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+
+    // A symbol name must fit on one line of the map
+    std::string SymbolName(const std::u16string &pattern, const std::string &flags) {
+        std::string name = "pcre2:/";
+        size_t length = std::min(pattern.size(), kMaxPatternLength);
+        for (size_t i = 0; i < length; i++) {
+            uint32_t c = pattern[i];
+            if (c >= 0xD800 && c <= 0xDBFF && i + 1 < pattern.size() &&
+                pattern[i + 1] >= 0xDC00 && pattern[i + 1] <= 0xDFFF)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (pattern[++i] - 0xDC00);
+            } else if (c >= 0xD800 && c <= 0xDFFF) {
+                c = 0xFFFD;
+            } else if (c < 0x20 || c == 0x7F) {
+                c = ' ';
+            }
+            AppendUtf8(name, c);
+        }
+        if (length < pattern.size()) {
+            name += "...";
+        }
+        name += "/";
+        name += flags;
+        return name;
+    }
+}
+
+std::atomic<bool> JitPerfMap::s_enabled(false);
+std::mutex JitPerfMap::s_mutex;
+FILE *JitPerfMap::s_file = nullptr;
+std::string JitPerfMap::s_path;
+std::unordered_map<const pcre2_code*, JitPerfMap::Entry> JitPerfMap::s_entries;
+
+bool JitPerfMap::Supported() {
+#ifdef NODE_PCRE2_JIT_PERF_MAP_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string JitPerfMap::Enable(const std::string &path) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    std::string newPath = path;
+    if (newPath.empty()) {
+        std::ostringstream oss;
+        oss << "/tmp/perf-" << getpid() << ".map";
+        newPath = oss.str();
+    }
+
+    if (s_file != nullptr && newPath == s_path) {
+        return s_path;
+    }
+
+    FILE *file = fopen(newPath.c_str(), "a");
+    if (file == nullptr) {
+        return std::string();
+    }
+
+    if (s_file != nullptr) {
+        fclose(s_file);
+    }
+    s_file = file;
+    s_path = newPath;
+    s_entries.clear();
+    s_enabled = true;
+    return s_path;
+}
+
+void JitPerfMap::Disable() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    s_enabled = false;
+    if (s_file != nullptr) {
+        fclose(s_file);
+        s_file = nullptr;
+    }
+    s_path.clear();
+    s_entries.clear();
+}
+
+bool JitPerfMap::Enabled() {
+    return s_enabled;
+}
+
+void JitPerfMap::Register(const pcre2_code *code, const std::u16string &pattern, const std::string &flags) {
+    if (!s_enabled) {
+        return;
+    }
+
+    std::vector<Range> ranges = Ranges(code);
+    if (ranges.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_file == nullptr) {
+        return;
+    }
+
+    Entry &entry = s_entries[code];
+    if (entry.name.empty()) {
+        entry.name = SymbolName(pattern, flags);
+    }
+
+    // Code compiled for another mode keeps the ranges of the earlier ones
+    Entry added{entry.name, {}};
+    for (const Range &range : ranges) {
+        bool known = false;
+        for (const Range &old : entry.ranges) {
+            known = known || (old.start == range.start && old.size == range.size);
+        }
+        if (!known) {
+            added.ranges.push_back(range);
+        }
+    }
+
+    entry.ranges = ranges;
+    Write(added, "");
+}
+
+void JitPerfMap::Free(pcre2_code *code) {
+    if (s_enabled) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+
+        auto entry = s_entries.find(code);
+        if (entry != s_entries.end()) {
+            Write(entry->second, " (freed)");
+            s_entries.erase(entry);
+        }
+    }
+
+    pcre2_code_free(code);
+}
+
+std::vector<JitPerfMap::Range> JitPerfMap::Ranges(const pcre2_code *code) {
+    std::vector<Range> ranges;
+#ifdef NODE_PCRE2_JIT_PERF_MAP_SUPPORTED
+
+    size_t jitSize;
+    if (pcre2_pattern_info(code, PCRE2_INFO_JITSIZE, &jitSize) != 0 || jitSize == 0) {
+        return ranges;
+    }
+
+    const RealCodeHead *head = reinterpret_cast<const RealCodeHead*>(code);
+    const ExecutableFunctionsHead *functions =
+        static_cast<const ExecutableFunctionsHead*>(head->executableJit);
+    if (functions == nullptr) {
+        return ranges;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < kJitCompileModes; i++) {
+        if (functions->executableFuncs[i] != nullptr) {
+            ranges.push_back(Range{
+                reinterpret_cast<uintptr_t>(functions->executableFuncs[i]),
+                functions->executableSizes[i],
+                kModeSuffixes[i],
+            });
+        }
+        total += functions->executableSizes[i];
+    }
+
+    if (total != jitSize) {
+        ranges.clear();
+    }
+#endif
+
+    return ranges;
+}
+
+void JitPerfMap::Write(const Entry &entry, const char *suffix) {
+    for (const Range &range : entry.ranges) {
+        fprintf(s_file, "%llx %zx %s%s%s\n",
+            static_cast<unsigned long long>(range.start),
+            range.size,
+            entry.name.c_str(),
+            range.mode,
+            suffix);
+    }
+    fflush(s_file);
+}
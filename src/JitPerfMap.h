@@ -0,0 +1,57 @@
+#ifndef NODE_PCRE2_JIT_PERF_MAP_H_
+#define NODE_PCRE2_JIT_PERF_MAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pcre2.h>
+
+// Process wide perf map (/tmp/perf-<pid>.map) of the JIT code of compiled
+// patterns, so that profilers such as perf attribute samples in it to the
+// pattern instead of an unknown address. Entries are appended as code is JIT
+// compiled, and appended again marked as freed when the code is freed.
+//
+// PCRE2 doesn't expose where its JIT code is, so it is read from PCRE2's
+// private structures, only for the PCRE2 versions their layout was checked
+// against, and only trusted when the sizes found there add up to
+// PCRE2_INFO_JITSIZE.
+class JitPerfMap {
+public:
+    // Whether the PCRE2 version built against is one of those
+    static bool Supported();
+    // Returns the path of the map, which defaults to /tmp/perf-<pid>.map
+    static std::string Enable(const std::string &path);
+    static void Disable();
+    static bool Enabled();
+
+    static void Register(const pcre2_code *code, const std::u16string &pattern, const std::string &flags);
+    // Deleter for compiled code
+    static void Free(pcre2_code *code);
+
+private:
+    struct Range {
+        uintptr_t start;
+        size_t size;
+        const char *mode;
+    };
+
+    struct Entry {
+        std::string name;
+        std::vector<Range> ranges;
+    };
+
+    static std::vector<Range> Ranges(const pcre2_code *code);
+    static void Write(const Entry &entry, const char *suffix);
+
+    static std::atomic<bool> s_enabled;
+    static std::mutex s_mutex;
+    static FILE *s_file;
+    static std::string s_path;
+    static std::unordered_map<const pcre2_code*, Entry> s_entries;
+};
+
+#endif // NODE_PCRE2_JIT_PERF_MAP_H_
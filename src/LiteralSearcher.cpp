@@ -0,0 +1,197 @@
+#include "LiteralSearcher.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NODE_PCRE2_LITERAL_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NODE_PCRE2_LITERAL_NEON
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    bool IsAsciiLetter(char16_t c) {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    }
+
+    char16_t FoldAscii(char16_t c) {
+        return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    }
+
+    bool IsMetacharacter(char16_t c) {
+        switch (c) {
+            case '\\':
+            case '^':
+            case '$':
+            case '.':
+            case '|':
+            case '?':
+            case '*':
+            case '+':
+            case '(':
+            case ')':
+            case '[':
+            case ']':
+            case '{':
+            case '}':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool IsAsciiPunctuation(char16_t c) {
+        return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+    }
+
+#if defined(NODE_PCRE2_LITERAL_SSE2) || defined(NODE_PCRE2_LITERAL_NEON)
+    unsigned CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+#endif
+}
+
+LiteralSearcher::LiteralSearcher(const std::u16string &literal, bool caseless)
+    : m_literal(literal)
+    , m_caseless(caseless)
+    , m_firstMask(0)
+    , m_lastMask(0)
+{
+    if (m_caseless) {
+        for (char16_t &c : m_literal) {
+            c = FoldAscii(c);
+        }
+
+        m_firstMask = IsAsciiLetter(m_literal.front()) ? 0x20 : 0;
+        m_lastMask = IsAsciiLetter(m_literal.back()) ? 0x20 : 0;
+    }
+}
+
+bool LiteralSearcher::ParsePattern(const std::u16string &pattern, std::u16string &literal) {
+    literal.clear();
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char16_t c = pattern[i];
+        if (c == '\\') {
+            // Only escaped punctuation is a plain literal, other escapes have
+            // special meanings
+            if (i + 1 == pattern.size() || !IsAsciiPunctuation(pattern[i + 1])) {
+                return false;
+            }
+            literal.push_back(pattern[++i]);
+        } else if (IsMetacharacter(c)) {
+            return false;
+        } else {
+            literal.push_back(c);
+        }
+    }
+
+    return !literal.empty();
+}
+
+size_t LiteralSearcher::Length() const {
+    return m_literal.size();
+}
+
+bool LiteralSearcher::MatchesAt(const char16_t *subject, size_t length, size_t offset) const {
+    if (offset > length || length - offset < m_literal.size()) {
+        return false;
+    }
+
+    const char16_t *p = subject + offset;
+    if (!m_caseless) {
+        return std::char_traits<char16_t>::compare(p, m_literal.data(), m_literal.size()) == 0;
+    }
+
+    for (size_t i = 0; i < m_literal.size(); i++) {
+        if (FoldAscii(p[i]) != m_literal[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t LiteralSearcher::Find(const char16_t *subject, size_t length, size_t start) const {
+    size_t n = m_literal.size();
+    if (start > length || length - start < n) {
+        return npos;
+    }
+
+    size_t i = start;
+
+#if defined(NODE_PCRE2_LITERAL_SSE2)
+    // Compare the first and last code units of the literal against 8
+    // candidate positions at once, and only verify the positions where both
+    // are equal.
+    const __m128i first = _mm_set1_epi16(static_cast<short>(m_literal.front()));
+    const __m128i last = _mm_set1_epi16(static_cast<short>(m_literal.back()));
+    const __m128i firstMask = _mm_set1_epi16(static_cast<short>(m_firstMask));
+    const __m128i lastMask = _mm_set1_epi16(static_cast<short>(m_lastMask));
+
+    for (; i + n + 7 <= length; i += 8) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(subject + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(subject + i + n - 1));
+        __m128i eqFirst = _mm_cmpeq_epi16(_mm_or_si128(blockFirst, firstMask), first);
+        __m128i eqLast = _mm_cmpeq_epi16(_mm_or_si128(blockLast, lastMask), last);
+
+        // Two bits per code unit
+        uint64_t mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+        while (mask != 0) {
+            size_t candidate = i + CountTrailingZeros(mask) / 2;
+            if (MatchesAt(subject, length, candidate)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(NODE_PCRE2_LITERAL_NEON)
+    const uint16x8_t first = vdupq_n_u16(m_literal.front());
+    const uint16x8_t last = vdupq_n_u16(m_literal.back());
+    const uint16x8_t firstMask = vdupq_n_u16(m_firstMask);
+    const uint16x8_t lastMask = vdupq_n_u16(m_lastMask);
+
+    for (; i + n + 7 <= length; i += 8) {
+        uint16x8_t blockFirst = vld1q_u16(reinterpret_cast<const uint16_t*>(subject + i));
+        uint16x8_t blockLast = vld1q_u16(reinterpret_cast<const uint16_t*>(subject + i + n - 1));
+        uint16x8_t eqFirst = vceqq_u16(vorrq_u16(blockFirst, firstMask), first);
+        uint16x8_t eqLast = vceqq_u16(vorrq_u16(blockLast, lastMask), last);
+
+        // Narrow to one byte per code unit
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vandq_u16(eqFirst, eqLast))), 0);
+        while (mask != 0) {
+            size_t candidate = i + CountTrailingZeros(mask) / 8;
+            if (MatchesAt(subject, length, candidate)) {
+                return candidate;
+            }
+            mask &= ~(static_cast<uint64_t>(0xff) << (CountTrailingZeros(mask) & ~7u));
+        }
+    }
+#endif
+
+    return FindScalar(subject, length, i);
+}
+
+size_t LiteralSearcher::FindScalar(const char16_t *subject, size_t length, size_t start) const {
+    size_t n = m_literal.size();
+    char16_t first = m_literal.front();
+
+    for (size_t i = start; i + n <= length; i++) {
+        if ((subject[i] | m_firstMask) == first && MatchesAt(subject, length, i)) {
+            return i;
+        }
+    }
+
+    return npos;
+}
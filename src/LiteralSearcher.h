@@ -0,0 +1,38 @@
+#ifndef NODE_PCRE2_LITERAL_SEARCHER_H_
+#define NODE_PCRE2_LITERAL_SEARCHER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Substring search used instead of pcre2_match for patterns that are plain
+// literals. Caseless search is only supported for ASCII literals.
+class LiteralSearcher {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    LiteralSearcher(const std::u16string &literal, bool caseless);
+
+    LiteralSearcher(const LiteralSearcher&) = delete;
+    LiteralSearcher& operator=(const LiteralSearcher&) = delete;
+
+    // Returns the literal a pattern matches, after escape processing, if it
+    // consists only of literal characters and escaped ASCII punctuation.
+    static bool ParsePattern(const std::u16string &pattern, std::u16string &literal);
+
+    size_t Length() const;
+    size_t Find(const char16_t *subject, size_t length, size_t start) const;
+    bool MatchesAt(const char16_t *subject, size_t length, size_t offset) const;
+
+private:
+    size_t FindScalar(const char16_t *subject, size_t length, size_t start) const;
+
+    std::u16string m_literal;
+    bool m_caseless;
+    // The bits ORed into the first/last code unit before comparing, to fold
+    // ASCII letters to lower case
+    char16_t m_firstMask;
+    char16_t m_lastMask;
+};
+
+#endif // NODE_PCRE2_LITERAL_SEARCHER_H_
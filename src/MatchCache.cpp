@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "MatchCache.h"
+
+namespace {
+    // Per entry bookkeeping besides the subject and ovector, roughly a list
+    // node and a hash table node
+    const size_t kEntryOverhead = sizeof(void*) * 8;
+}
+
+size_t MatchCache::KeyHash::operator()(const Key &key) const {
+    // FNV-1a over the code units
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char16_t c : key.subject) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    hash = (hash ^ key.startOffset) * 0x100000001b3ULL;
+    hash = (hash ^ key.options) * 0x100000001b3ULL;
+    return static_cast<size_t>(hash);
+}
+
+size_t MatchCache::Entry::MemorySize() const {
+    return subject.size() * sizeof(char16_t) + ovector.size() * sizeof(PCRE2_SIZE) + kEntryOverhead;
+}
+
+MatchCache::MatchCache(size_t capacity, size_t maxSubjectLength)
+    : m_capacity(capacity)
+    , m_maxSubjectLength(maxSubjectLength)
+    , m_memorySize(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_bypassed(0)
+{
+}
+
+bool MatchCache::Accepts(const std::u16string &subject) {
+    if (subject.size() > m_maxSubjectLength) {
+        m_bypassed++;
+        return false;
+    }
+
+    return true;
+}
+
+bool MatchCache::Lookup(const std::u16string &subject, size_t startOffset, uint32_t options, pcre2_match_data *matchData, int &rc) {
+    auto found = m_index.find(Key{subject, startOffset, options});
+    if (found == m_index.end()) {
+        m_misses++;
+        return false;
+    }
+
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+
+    const Entry &entry = *found->second;
+    rc = entry.rc;
+
+    // Pairs past the ones the result covers are unset, as pcre2_match leaves
+    // them
+    PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(matchData);
+    uint32_t pairs = pcre2_get_ovector_count(matchData);
+    std::copy(entry.ovector.begin(), entry.ovector.end(), ovector);
+    std::fill(ovector + entry.ovector.size(), ovector + 2 * static_cast<size_t>(pairs), PCRE2_UNSET);
+    return true;
+}
+
+void MatchCache::Store(const std::u16string &subject, size_t startOffset, uint32_t options, pcre2_match_data *matchData, int rc) {
+    if (m_capacity == 0 || (rc <= 0 && rc != PCRE2_ERROR_NOMATCH)) {
+        return;
+    }
+
+    if (m_index.find(Key{subject, startOffset, options}) != m_index.end()) {
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        const Entry &last = m_entries.back();
+        m_memorySize -= last.MemorySize();
+        m_index.erase(Key{last.subject, last.startOffset, last.options});
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front(Entry{subject, startOffset, options, rc, {}});
+    Entry &entry = m_entries.front();
+    if (rc > 0) {
+        PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(matchData);
+        entry.ovector.assign(ovector, ovector + 2 * static_cast<size_t>(rc));
+    }
+    m_memorySize += entry.MemorySize();
+    m_index.emplace(Key{entry.subject, startOffset, options}, m_entries.begin());
+}
+
+size_t MatchCache::MemorySize() const {
+    return m_memorySize;
+}
+
+Napi::Object MatchCache::ToObject(Napi::Env env) const {
+    Napi::Object result = Napi::Object::New(env);
+    result["capacity"] = static_cast<double>(m_capacity);
+    result["size"] = static_cast<double>(m_entries.size());
+    result["hits"] = static_cast<double>(m_hits);
+    result["misses"] = static_cast<double>(m_misses);
+    result["bypassed"] = static_cast<double>(m_bypassed);
+    uint64_t lookups = m_hits + m_misses;
+    result["hitRate"] = lookups > 0 ? static_cast<double>(m_hits) / lookups : 0.0;
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef NODE_PCRE2_MATCH_CACHE_H_
+#define NODE_PCRE2_MATCH_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <napi.h>
+#include <pcre2.h>
+
+// Least recently used cache of match results by subject, start offset and
+// options, so that repeated subjects skip pcre2_match. Results are stored as
+// the return code and the ovector pairs it covers, and written back into the
+// match data on a hit the same way pcre2_match would have. Subjects longer
+// than maxSubjectLength bypass the cache, which bounds its memory.
+class MatchCache {
+public:
+    MatchCache(size_t capacity, size_t maxSubjectLength);
+
+    MatchCache(const MatchCache&) = delete;
+    MatchCache& operator=(const MatchCache&) = delete;
+
+    // Whether a subject is short enough to be cached, counting the ones that
+    // aren't
+    bool Accepts(const std::u16string &subject);
+    // Returns whether the result was cached, in which case rc is set and the
+    // ovector filled in
+    bool Lookup(const std::u16string &subject, size_t startOffset, uint32_t options, pcre2_match_data *matchData, int &rc);
+    // Only matches and PCRE2_ERROR_NOMATCH are cached, not errors
+    void Store(const std::u16string &subject, size_t startOffset, uint32_t options, pcre2_match_data *matchData, int rc);
+
+    size_t MemorySize() const;
+    Napi::Object ToObject(Napi::Env env) const;
+
+private:
+    // Refers to the subject of its entry, or to the caller's on lookup
+    struct Key {
+        std::u16string_view subject;
+        size_t startOffset;
+        uint32_t options;
+
+        bool operator==(const Key &other) const {
+            return startOffset == other.startOffset && options == other.options && subject == other.subject;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        std::u16string subject;
+        size_t startOffset;
+        uint32_t options;
+        int rc;
+        std::vector<PCRE2_SIZE> ovector;
+
+        size_t MemorySize() const;
+    };
+
+    size_t m_capacity;
+    size_t m_maxSubjectLength;
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    size_t m_memorySize;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_bypassed;
+};
+
+#endif // NODE_PCRE2_MATCH_CACHE_H_
@@ -0,0 +1,44 @@
+#include "MatchDataPool.h"
+
+namespace {
+    // Idle match data kept per ovector size
+    constexpr size_t kMaxFreePerSize = 8;
+    // Match data whose heap frames grew larger than this isn't kept, so a
+    // single large match doesn't pin the memory forever
+    constexpr size_t kMaxPooledHeapFramesSize = 1024 * 1024;
+}
+
+MatchDataPool::MatchDataPool(pcre2_general_context *generalContext)
+    : m_generalContext(generalContext)
+{
+}
+
+MatchDataPool::~MatchDataPool() {
+    for (auto &bucket : m_free) {
+        for (pcre2_match_data *matchData : bucket.second) {
+            pcre2_match_data_free(matchData);
+        }
+    }
+}
+
+pcre2_match_data *MatchDataPool::Acquire(uint32_t ovectorSize) {
+    auto bucket = m_free.find(ovectorSize);
+    if (bucket != m_free.end() && !bucket->second.empty()) {
+        pcre2_match_data *matchData = bucket->second.back();
+        bucket->second.pop_back();
+        return matchData;
+    }
+
+    return pcre2_match_data_create(ovectorSize, m_generalContext);
+}
+
+void MatchDataPool::Release(pcre2_match_data *matchData) {
+    std::vector<pcre2_match_data*> &bucket = m_free[pcre2_get_ovector_count(matchData)];
+    if (bucket.size() >= kMaxFreePerSize ||
+        pcre2_get_match_data_heapframes_size(matchData) > kMaxPooledHeapFramesSize) {
+        pcre2_match_data_free(matchData);
+        return;
+    }
+
+    bucket.push_back(matchData);
+}
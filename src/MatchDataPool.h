@@ -0,0 +1,26 @@
+#ifndef NODE_PCRE2_MATCH_DATA_POOL_H_
+#define NODE_PCRE2_MATCH_DATA_POOL_H_
+
+#include <unordered_map>
+#include <vector>
+#include <pcre2.h>
+
+// Match data shared by the PCRE2 instances of an environment that don't keep
+// their own, bucketed by ovector size.
+class MatchDataPool {
+public:
+    explicit MatchDataPool(pcre2_general_context *generalContext);
+    ~MatchDataPool();
+
+    MatchDataPool(const MatchDataPool&) = delete;
+    MatchDataPool& operator=(const MatchDataPool&) = delete;
+
+    pcre2_match_data *Acquire(uint32_t ovectorSize);
+    void Release(pcre2_match_data *matchData);
+
+private:
+    pcre2_general_context *m_generalContext;
+    std::unordered_map<uint32_t, std::vector<pcre2_match_data*>> m_free;
+};
+
+#endif // NODE_PCRE2_MATCH_DATA_POOL_H_
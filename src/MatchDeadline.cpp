@@ -0,0 +1,90 @@
+#include "InstanceData.h"
+#include "JitPerfMap.h"
+#include "MatchDeadline.h"
+
+namespace {
+    // Reading the clock on every item would dominate matching
+    const uint32_t kCheckInterval = 1000;
+}
+
+MatchDeadline::MatchDeadline(Napi::Env env, pcre2_code *code, pcre2_general_context *generalContext, uint32_t matchLimit)
+    : m_env(env)
+    , m_code(code)
+    , m_jitSize(0)
+    , m_active(false)
+    , m_expired(false)
+    , m_timeoutMs(0)
+    , m_countdown(kCheckInterval)
+{
+    // Callouts are supported by JIT code, so unlike the profiler this copy is
+    // compiled right away
+    pcre2_jit_compile(m_code, PCRE2_JIT_COMPLETE);
+    pcre2_pattern_info(m_code, PCRE2_INFO_JITSIZE, &m_jitSize);
+    m_env.GetInstanceData<InstanceData>()->jitSize += m_jitSize;
+    Napi::MemoryManagement::AdjustExternalMemory(m_env, m_jitSize);
+
+    m_matchContext = pcre2_match_context_create(generalContext);
+    pcre2_set_callout(m_matchContext, Callout, this);
+    if (matchLimit != 0) {
+        pcre2_set_match_limit(m_matchContext, matchLimit);
+    }
+}
+
+MatchDeadline::~MatchDeadline() {
+    m_env.GetInstanceData<InstanceData>()->jitSize -= m_jitSize;
+    Napi::MemoryManagement::AdjustExternalMemory(m_env, -static_cast<int64_t>(m_jitSize));
+
+    pcre2_match_context_free(m_matchContext);
+    JitPerfMap::Free(m_code);
+}
+
+pcre2_code *MatchDeadline::Code() const {
+    return m_code;
+}
+
+pcre2_match_context *MatchDeadline::MatchContext() const {
+    return m_matchContext;
+}
+
+void MatchDeadline::Start(double timeoutMs) {
+    m_active = true;
+    m_expired = false;
+    m_timeoutMs = timeoutMs;
+    m_expiry = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(timeoutMs));
+    m_countdown = kCheckInterval;
+}
+
+void MatchDeadline::Stop() {
+    m_active = false;
+}
+
+bool MatchDeadline::Active() const {
+    return m_active;
+}
+
+bool MatchDeadline::Expired() const {
+    return m_expired;
+}
+
+double MatchDeadline::TimeoutMs() const {
+    return m_timeoutMs;
+}
+
+int MatchDeadline::Callout(pcre2_callout_block *block, void *data) {
+    MatchDeadline *deadline = static_cast<MatchDeadline*>(data);
+
+    if (--deadline->m_countdown != 0) {
+        return 0;
+    }
+    deadline->m_countdown = kCheckInterval;
+
+    if (std::chrono::steady_clock::now() >= deadline->m_expiry) {
+        deadline->m_expired = true;
+        // Reserved for callouts, PCRE2 never returns it by itself
+        return PCRE2_ERROR_CALLOUT;
+    }
+
+    return 0;
+}
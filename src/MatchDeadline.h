@@ -0,0 +1,47 @@
+#ifndef NODE_PCRE2_MATCH_DEADLINE_H_
+#define NODE_PCRE2_MATCH_DEADLINE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <napi.h>
+#include <pcre2.h>
+
+// Enforces a wall clock deadline on matching, using a copy of the pattern
+// compiled with PCRE2_AUTO_CALLOUT whose callout checks the clock every so
+// many items. The copy is only used while a deadline is active, so matching
+// without one is unaffected.
+class MatchDeadline {
+public:
+    // Takes ownership of code, which must be compiled with PCRE2_AUTO_CALLOUT
+    MatchDeadline(Napi::Env env, pcre2_code *code, pcre2_general_context *generalContext, uint32_t matchLimit);
+    ~MatchDeadline();
+
+    MatchDeadline(const MatchDeadline&) = delete;
+    MatchDeadline& operator=(const MatchDeadline&) = delete;
+
+    pcre2_code *Code() const;
+    pcre2_match_context *MatchContext() const;
+
+    void Start(double timeoutMs);
+    void Stop();
+    bool Active() const;
+    // Whether matching was aborted with PCRE2_ERROR_CALLOUT because the
+    // deadline passed
+    bool Expired() const;
+    double TimeoutMs() const;
+
+private:
+    static int Callout(pcre2_callout_block *block, void *data);
+
+    Napi::Env m_env;
+    pcre2_code *m_code;
+    pcre2_match_context *m_matchContext;
+    size_t m_jitSize;
+    bool m_active;
+    bool m_expired;
+    double m_timeoutMs;
+    std::chrono::steady_clock::time_point m_expiry;
+    uint32_t m_countdown;
+};
+
+#endif // NODE_PCRE2_MATCH_DEADLINE_H_
@@ -0,0 +1,214 @@
+#include "MatchRecorder.h"
+
+namespace {
+    enum RecordType : uint8_t {
+        kPatternRecord = 1,
+        kCompileRecord = 2,
+        kMatchRecord = 3,
+    };
+
+    void AppendU8(std::string &out, uint8_t value) {
+        out += static_cast<char>(value);
+    }
+
+    void AppendU32(std::string &out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void AppendU64(std::string &out, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    void AppendUtf16(std::string &out, const std::u16string &value) {
+        for (char16_t c : value) {
+            out += static_cast<char>(c & 0xFF);
+            out += static_cast<char>(c >> 8);
+        }
+    }
+
+    char16_t Redact(char16_t c) {
+        if (c >= u'a' && c <= u'z') {
+            return u'a';
+        }
+        if (c >= u'A' && c <= u'Z') {
+            return u'A';
+        }
+        if (c >= u'0' && c <= u'9') {
+            return u'0';
+        }
+        if (c >= 0x80) {
+            return u'x';
+        }
+        return c;
+    }
+}
+
+std::atomic<bool> MatchRecorder::s_recording(false);
+std::atomic<uint32_t> MatchRecorder::s_sampleCounter(0);
+std::atomic<uint32_t> MatchRecorder::s_sampleInterval(1);
+MatchRecorder::Subjects MatchRecorder::s_subjects = MatchRecorder::Subjects::Length;
+std::mutex MatchRecorder::s_mutex;
+FILE *MatchRecorder::s_file = nullptr;
+bool MatchRecorder::s_failed = false;
+int64_t MatchRecorder::s_records = 0;
+std::map<std::pair<std::u16string, std::string>, uint32_t> MatchRecorder::s_patterns;
+
+bool MatchRecorder::Start(const std::string &path, uint32_t sampleInterval, Subjects subjects) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    if (s_file != nullptr) {
+        fclose(s_file);
+    }
+    s_file = file;
+    s_failed = false;
+    s_sampleInterval = sampleInterval;
+    s_subjects = subjects;
+    s_records = 0;
+    s_patterns.clear();
+
+    std::string header = "PCRE2TRC";
+    AppendU32(header, kVersion);
+    AppendU32(header, static_cast<uint32_t>(subjects));
+    if (fwrite(header.data(), 1, header.size(), s_file) != header.size()) {
+        fclose(s_file);
+        s_file = nullptr;
+        return false;
+    }
+
+    s_sampleCounter = 0;
+    s_recording = true;
+    return true;
+}
+
+int64_t MatchRecorder::Stop(bool &failed) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    s_recording = false;
+    failed = s_failed;
+    if (s_file == nullptr) {
+        if (!s_failed) {
+            return -1;
+        }
+        s_failed = false;
+        return s_records;
+    }
+
+    // Buffered records are only written out here
+    if (fclose(s_file) != 0) {
+        failed = true;
+    }
+    s_file = nullptr;
+    s_patterns.clear();
+    return s_records;
+}
+
+bool MatchRecorder::Recording() {
+    return s_recording.load(std::memory_order_relaxed);
+}
+
+bool MatchRecorder::Sample() {
+    if (!s_recording.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    return s_sampleCounter.fetch_add(1, std::memory_order_relaxed) % s_sampleInterval.load(std::memory_order_relaxed) == 0;
+}
+
+void MatchRecorder::RecordCompile(const std::u16string &pattern, const std::string &flags, uint64_t durationNs) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_file == nullptr) {
+        return;
+    }
+
+    std::string record;
+    AppendU8(record, kCompileRecord);
+    AppendU32(record, PatternId(pattern, flags));
+    AppendU64(record, durationNs);
+    Write(record);
+}
+
+void MatchRecorder::RecordMatch(const Match &match) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_file == nullptr) {
+        return;
+    }
+
+    std::string record;
+    AppendU8(record, kMatchRecord);
+    AppendU32(record, PatternId(match.pattern, match.flags));
+    AppendU8(record, match.kind);
+    AppendU32(record, match.options);
+    AppendU32(record, static_cast<uint32_t>(match.startOffset));
+    AppendU32(record, static_cast<uint32_t>(match.subject.size()));
+    AppendU32(record, static_cast<uint32_t>(match.rc));
+    AppendU8(record, match.jit ? 1 : 0);
+    AppendU64(record, match.durationNs);
+
+    if (s_subjects == Subjects::Full) {
+        AppendUtf16(record, match.subject);
+    } else if (s_subjects == Subjects::Redacted) {
+        std::u16string redacted(match.subject.size(), u'\0');
+        for (size_t i = 0; i < match.subject.size(); i++) {
+            redacted[i] = Redact(match.subject[i]);
+        }
+        AppendUtf16(record, redacted);
+    }
+
+    // The replacement is part of the program rather than its input, so it is
+    // kept as is
+    if (match.replacement != nullptr) {
+        AppendU32(record, static_cast<uint32_t>(match.replacement->size()));
+        AppendUtf16(record, *match.replacement);
+    }
+
+    Write(record);
+}
+
+uint32_t MatchRecorder::PatternId(const std::u16string &pattern, const std::string &flags) {
+    auto inserted = s_patterns.emplace(std::make_pair(pattern, flags), static_cast<uint32_t>(s_patterns.size()));
+    uint32_t id = inserted.first->second;
+    if (inserted.second) {
+        std::string record;
+        AppendU8(record, kPatternRecord);
+        AppendU32(record, id);
+        AppendU32(record, static_cast<uint32_t>(flags.size()));
+        record += flags;
+        AppendU32(record, static_cast<uint32_t>(pattern.size()));
+        AppendUtf16(record, pattern);
+        if (fwrite(record.data(), 1, record.size(), s_file) != record.size()) {
+            Fail();
+        }
+    }
+
+    return id;
+}
+
+void MatchRecorder::Write(const std::string &record) {
+    // Writing the pattern record may have failed already
+    if (s_file == nullptr) {
+        return;
+    }
+
+    if (fwrite(record.data(), 1, record.size(), s_file) != record.size()) {
+        Fail();
+        return;
+    }
+    s_records++;
+}
+
+void MatchRecorder::Fail() {
+    s_recording = false;
+    s_failed = true;
+    fclose(s_file);
+    s_file = nullptr;
+    s_patterns.clear();
+}
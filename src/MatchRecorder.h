@@ -0,0 +1,86 @@
+#ifndef NODE_PCRE2_MATCH_RECORDER_H_
+#define NODE_PCRE2_MATCH_RECORDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Process wide recorder of compilations and sampled matching calls into a
+// binary trace file, for replaying real workloads offline with
+// bench/replay.mts. Nothing is recorded unless started.
+//
+// The trace is little endian. It starts with the magic "PCRE2TRC", a u32
+// version and a u32 subjects mode, followed by records, each a u8 type:
+// * Pattern (1): u32 id, u32 flags length, UTF-8 flags, u32 pattern length,
+//   UTF-16 pattern. Written before the first record using the pattern.
+// * Compile (2): u32 pattern id, u64 duration in ns.
+// * Match (3): u32 pattern id, u8 kind (0 match, 1 substitute), u32 PCRE2
+//   options, u32 start offset, u32 subject length, i32 return code, u8 JIT,
+//   u64 duration in ns, then the UTF-16 subject unless the subjects mode is
+//   length only, then for substitute a u32 replacement length and the UTF-16
+//   replacement.
+class MatchRecorder {
+public:
+    enum class Subjects : uint32_t {
+        // Only the length of subjects is recorded
+        Length = 0,
+        // ASCII letters and digits are replaced by a, A and 0, and other
+        // non-ASCII code units by x, keeping the length and punctuation
+        Redacted = 1,
+        Full = 2,
+    };
+
+    struct Match {
+        // 0 for match, 1 for substitute
+        uint8_t kind;
+        const std::u16string &pattern;
+        const std::string &flags;
+        const std::u16string &subject;
+        size_t startOffset;
+        uint32_t options;
+        // nullptr for match
+        const std::u16string *replacement;
+        int rc;
+        bool jit;
+        uint64_t durationNs;
+    };
+
+    // Replaces any recording in progress. Returns false when the file can't
+    // be created.
+    static bool Start(const std::string &path, uint32_t sampleInterval, Subjects subjects);
+    // Returns the number of compile and match records written, or -1 when
+    // not recording. failed is set when writing the trace failed, in which
+    // case recording stopped at the failure and the trace is incomplete.
+    static int64_t Stop(bool &failed);
+
+    static bool Recording();
+    // Returns whether to record this call, when recording one in every
+    // sampleInterval calls
+    static bool Sample();
+    static void RecordCompile(const std::u16string &pattern, const std::string &flags, uint64_t durationNs);
+    static void RecordMatch(const Match &match);
+
+    static const uint32_t kVersion = 1;
+
+private:
+    static uint32_t PatternId(const std::u16string &pattern, const std::string &flags);
+    static void Write(const std::string &record);
+    // Stops recording after a failed write, keeping the failure for Stop
+    static void Fail();
+
+    static std::atomic<bool> s_recording;
+    static std::atomic<uint32_t> s_sampleCounter;
+    static std::atomic<uint32_t> s_sampleInterval;
+    static Subjects s_subjects;
+    static std::mutex s_mutex;
+    static FILE *s_file;
+    static bool s_failed;
+    static int64_t s_records;
+    static std::map<std::pair<std::u16string, std::string>, uint32_t> s_patterns;
+};
+
+#endif // NODE_PCRE2_MATCH_RECORDER_H_
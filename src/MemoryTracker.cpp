@@ -0,0 +1,68 @@
+#include <cstddef>
+#include <cstdlib>
+#include "MemoryTracker.h"
+
+namespace {
+    // The allocation size is stored in front of each allocation, padded to keep
+    // the alignment malloc guarantees
+    constexpr size_t kHeaderSize = alignof(std::max_align_t);
+}
+
+MemoryTracker::MemoryTracker()
+    : m_allocated(0)
+    , m_refs(1)
+{
+    m_generalContext = pcre2_general_context_create(Malloc, Free, this);
+}
+
+MemoryTracker::~MemoryTracker() {}
+
+void MemoryTracker::Release() {
+    pcre2_general_context *generalContext = m_generalContext;
+    m_generalContext = nullptr;
+    // Freeing the context drops the reference of its own allocation, so the
+    // owner's reference has to be dropped only afterwards
+    pcre2_general_context_free(generalContext);
+
+    if (--m_refs == 0) {
+        delete this;
+    }
+}
+
+pcre2_general_context *MemoryTracker::GeneralContext() const {
+    return m_generalContext;
+}
+
+size_t MemoryTracker::Allocated() const {
+    return m_allocated.load(std::memory_order_relaxed);
+}
+
+void *MemoryTracker::Malloc(PCRE2_SIZE size, void *data) {
+    MemoryTracker *tracker = static_cast<MemoryTracker*>(data);
+
+    char *ptr = static_cast<char*>(std::malloc(kHeaderSize + size));
+    if (ptr == nullptr) {
+        return nullptr;
+    }
+
+    *reinterpret_cast<PCRE2_SIZE*>(ptr) = size;
+    tracker->m_allocated.fetch_add(size, std::memory_order_relaxed);
+    tracker->m_refs.fetch_add(1, std::memory_order_relaxed);
+    return ptr + kHeaderSize;
+}
+
+void MemoryTracker::Free(void *ptr, void *data) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    MemoryTracker *tracker = static_cast<MemoryTracker*>(data);
+
+    char *block = static_cast<char*>(ptr) - kHeaderSize;
+    tracker->m_allocated.fetch_sub(*reinterpret_cast<PCRE2_SIZE*>(block), std::memory_order_relaxed);
+    std::free(block);
+
+    if (tracker->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete tracker;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef NODE_PCRE2_MEMORY_TRACKER_H_
+#define NODE_PCRE2_MEMORY_TRACKER_H_
+
+#include <atomic>
+#include <pcre2.h>
+
+// Counts the memory PCRE2 allocates through its general context. Everything
+// allocated through it holds a reference to the tracker, so memory that
+// outlives the owner (e.g. shared code freed by another environment) is still
+// accounted for correctly.
+class MemoryTracker {
+public:
+    MemoryTracker();
+
+    MemoryTracker(const MemoryTracker&) = delete;
+    MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+    // Drops the owner's reference
+    void Release();
+
+    pcre2_general_context *GeneralContext() const;
+    size_t Allocated() const;
+
+private:
+    ~MemoryTracker();
+
+    static void *Malloc(PCRE2_SIZE size, void *data);
+    static void Free(void *ptr, void *data);
+
+    std::atomic<size_t> m_allocated;
+    std::atomic<size_t> m_refs;
+    pcre2_general_context *m_generalContext;
+};
+
+#endif // NODE_PCRE2_MEMORY_TRACKER_H_
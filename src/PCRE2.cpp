@@ -1,11 +1,72 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <sstream>
+#include <thread>
+#include "ExternalString.h"
 #include "InstanceData.h"
+#include "JitPerfMap.h"
+#include "MatchRecorder.h"
 #include "PCRE2.h"
+#include "PCRE2CompileWorker.h"
+#include "PCRE2FilterWorker.h"
+#include "PatternAnalysis.h"
+#include "RequiredLiterals.h"
+#include "SharedCodeRegistry.h"
 
 const napi_type_tag PCRE2TypeTag = {
     0x1edf75a38336451d, 0xa5ed9ce2e4c00c38
 };
 
+// Converts a string into a buffer reused across calls, so that batches of
+// short strings don't allocate one each
+static void ReadString(Napi::Env env, const Napi::Value &value, std::u16string &buffer) {
+    napi_value string = value.ToString();
+    size_t length;
+    napi_status status = napi_get_value_string_utf16(env, string, nullptr, 0, &length);
+    if (status == napi_ok) {
+        buffer.resize(length);
+        status = napi_get_value_string_utf16(env, string, &buffer[0], length + 1, &length);
+    }
+    if (status != napi_ok) {
+        throw Napi::Error::New(env);
+    }
+}
+
+// Reads a size option, rejecting what would otherwise wrap around or be
+// silently truncated
+static double ReadCountOption(Napi::Env env, const Napi::Value &value, const char *name, double max, double min = 0) {
+    double count = value.ToNumber().DoubleValue();
+    if (!(count >= min && count <= max) || count != std::floor(count)) {
+        throw Napi::RangeError::New(env, std::string("Invalid ") + name + " option");
+    }
+    return count;
+}
+
+// Longer timeouts are cut to this, the longest setTimeout delay, which keeps
+// the deadline within the range of the steady clock
+const double kMaxTimeoutMs = 2147483647;
+
+// Reads a timeout, where 0 and Infinity mean no deadline
+static double ReadTimeoutOption(Napi::Env env, const Napi::Value &value) {
+    double timeoutMs = value.ToNumber().DoubleValue();
+    if (!(timeoutMs >= 0)) {
+        throw Napi::RangeError::New(env, "Invalid timeoutMs option");
+    }
+    if (std::isinf(timeoutMs)) {
+        return 0;
+    }
+    return std::min(timeoutMs, kMaxTimeoutMs);
+}
+
+// Subjects longer than this bypass the match cache unless the
+// matchCacheMaxSubjectLength option says otherwise
+const size_t kDefaultMatchCacheMaxSubjectLength = 256;
+
+// The match limit applied to patterns found risky with the redos: "limit"
+// option, unless a matchLimit is given
+const uint32_t kRedosMatchLimit = 100000;
+
 Napi::Object PCRE2::Init(Napi::Env env, Napi::Object exports) {
     InstanceData *instanceData = env.GetInstanceData<InstanceData>();
 
@@ -19,6 +80,15 @@ Napi::Object PCRE2::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod<&PCRE2::Split>(instanceData->Symbol.Get("split").As<Napi::Symbol>()),
         InstanceMethod<&PCRE2::MatchAll>(instanceData->Symbol.Get("matchAll").As<Napi::Symbol>()),
         InstanceMethod<&PCRE2::Replace>(instanceData->Symbol.Get("replace").As<Napi::Symbol>()),
+        InstanceMethod<&PCRE2::FilterParallel>("filterParallel"),
+        InstanceMethod<&PCRE2::FilterPaths>("filterPaths"),
+        InstanceMethod<&PCRE2::ExtractColumns>("extractColumns"),
+        InstanceMethod<&PCRE2::Share>("share"),
+        InstanceMethod<&PCRE2::MemoryUsage>("memoryUsage"),
+        InstanceAccessor<&PCRE2::Stats>("stats"),
+        InstanceAccessor<&PCRE2::MatchCacheStats>("matchCache"),
+        InstanceMethod<&PCRE2::StartProfiling>("startProfiling"),
+        InstanceMethod<&PCRE2::StopProfiling>("stopProfiling"),
         InstanceAccessor<&PCRE2::GetLastIndex, &PCRE2::SetLastIndex>("lastIndex"),
         InstanceAccessor<&PCRE2::Source>("source"),
         InstanceAccessor<&PCRE2::Flags>("flags"),
@@ -43,10 +113,25 @@ Napi::Object PCRE2::Init(Napi::Env env, Napi::Object exports) {
         InstanceAccessor<&PCRE2::Ungreedy>("ungreedy"),
         InstanceAccessor<&PCRE2::PCRE2Mode>("pcre2Mode"),
         StaticAccessor<&PCRE2::Species>(instanceData->Symbol.Get("species").As<Napi::Symbol>()),
+        StaticMethod<&PCRE2::FromShared>("fromShared"),
+        StaticMethod<&PCRE2::ReleaseShared>("releaseShared"),
+        StaticMethod<&PCRE2::TotalMemoryUsage>("memoryUsage"),
+        StaticMethod<&PCRE2::GetStats>("getStats"),
+        StaticMethod<&PCRE2::Analyze>("analyze"),
+        StaticMethod<&PCRE2::CompileMany>("compileMany"),
+        StaticMethod<&PCRE2::FromGlob>("fromGlob"),
+        StaticMethod<&PCRE2::FromPosix>("fromPosix"),
+        StaticMethod<&PCRE2::SetSlowMatchThreshold>("setSlowMatchThreshold"),
+        StaticMethod<&PCRE2::EnablePerfMap>("enablePerfMap"),
+        StaticMethod<&PCRE2::DisablePerfMap>("disablePerfMap"),
+        StaticMethod<&PCRE2::StartRecording>("startRecording"),
+        StaticMethod<&PCRE2::StopRecording>("stopRecording"),
     });
 
     instanceData->PCRE2 = Napi::Persistent(func);
     exports.Set("PCRE2", func);
+    exports.Set("setSlowMatchPublisher", Napi::Function::New(env, SetSlowMatchPublisher, "setSlowMatchPublisher"));
+    exports.Set("setSlowMatchSubscribed", Napi::Function::New(env, SetSlowMatchSubscribed, "setSlowMatchSubscribed"));
 
     return exports;
 }
@@ -59,9 +144,22 @@ PCRE2::PCRE2(const Napi::CallbackInfo &info)
     , m_sticky(false)
     , m_hasIndices(false)
     , m_pcre2(false)
+    , m_matchData(nullptr)
+    , m_pooledMatchData(false)
+    , m_heapFramesLimit(0)
+    , m_matchDataDepth(0)
+    , m_statsEnabled(false)
+    , m_statsSampleInterval(16)
+    , m_matchLimit(0)
+    , m_matchContext(nullptr)
+    , m_timeoutMs(0)
+    , m_externalStrings(false)
+    , m_jit(true)
+    , m_matchCacheSize(0)
+    , m_matchCacheMaxSubjectLength(kDefaultMatchCacheMaxSubjectLength)
     , m_lastIndex(0)
     , m_tierUpTicks(1)
-    , m_matchDataHeapframesSize(0)
+    , m_jitSize(0)
 {
     InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
 
@@ -71,7 +169,13 @@ PCRE2::PCRE2(const Napi::CallbackInfo &info)
         throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
     }
 
-    if (info[0].IsObject() && info[0].As<Napi::Object>().InstanceOf(instanceData->RegExp.Value())) {
+    if (info[0].IsExternal()) {
+        // Constructing over already compiled code, see FromShared
+        const SharedCode *shared = info[0].As<Napi::External<SharedCode>>().Data();
+        m_code = shared->code;
+        m_pattern = shared->pattern;
+        m_flags = shared->flags;
+    } else if (info[0].IsObject() && info[0].As<Napi::Object>().InstanceOf(instanceData->RegExp.Value())) {
         Napi::Object re = info[0].As<Napi::Object>();
         Napi::Value source = re.Get("source");
         if (!source.IsString()) {
@@ -88,51 +192,122 @@ PCRE2::PCRE2(const Napi::CallbackInfo &info)
         PCRE2 *pcre2 = PCRE2::Unwrap(info[0].As<Napi::Object>());
         m_pattern = pcre2->m_pattern;
         m_flags = pcre2->m_flags;
+        m_pooledMatchData = pcre2->m_pooledMatchData;
+        m_heapFramesLimit = pcre2->m_heapFramesLimit;
+        m_statsEnabled = pcre2->m_statsEnabled;
+        m_statsSampleInterval = pcre2->m_statsSampleInterval;
+        m_matchLimit = pcre2->m_matchLimit;
+        m_timeoutMs = pcre2->m_timeoutMs;
+        m_externalStrings = pcre2->m_externalStrings;
+        m_jit = pcre2->m_jit;
+        m_matchCacheSize = pcre2->m_matchCacheSize;
+        m_matchCacheMaxSubjectLength = pcre2->m_matchCacheMaxSubjectLength;
     } else {
         m_pattern = info[0].ToString().Utf16Value();
     }
 
-    if (info.Length() > 1) {
+    if (info.Length() > 1 && !info[0].IsExternal() && !info[1].IsUndefined()) {
         m_flags = info[1].ToString().Utf8Value();
     }
 
-    ParseFlags(info.Env(), m_flags);
+    if (info.Length() > 2 && !info[2].IsUndefined()) {
+        ParseOptions(info.Env(), info[2].ToObject());
+    }
 
-    if (!m_pcre2) {
-        // Flags to try and behave more closely to JS RegExp
-        m_options |= PCRE2_ALT_BSUX | PCRE2_DOLLAR_ENDONLY | PCRE2_MATCH_UNSET_BACKREF;
-        m_extraOptions |= PCRE2_EXTRA_ALT_BSUX;
+    ParsedFlags parsed = ParseFlags(info.Env(), m_flags);
+    m_options = parsed.options;
+    m_extraOptions = parsed.extraOptions;
+    m_global = parsed.global;
+    m_sticky = parsed.sticky;
+    m_hasIndices = parsed.hasIndices;
+    m_pcre2 = parsed.pcre2;
+
+    if (m_matchCacheSize > 0) {
+        m_matchCache = std::make_shared<MatchCache>(m_matchCacheSize, m_matchCacheMaxSubjectLength);
     }
 
-    pcre2_compile_context *compileContext = pcre2_compile_context_copy(instanceData->compileContext);
-    pcre2_set_compile_extra_options(compileContext, m_extraOptions);
+    if (m_statsEnabled) {
+        m_stats = std::make_shared<PatternStats>(instanceData, m_pattern, m_flags, m_statsSampleInterval);
+    }
 
-    int errornumber;
-    size_t erroroffset;
-    m_re = pcre2_compile(
-        reinterpret_cast<PCRE2_SPTR>(m_pattern.c_str()),
-        m_pattern.size(),
-        m_options,
-        &errornumber,
-        &erroroffset,
-        compileContext
-    );
+    if (m_code) {
+        // Shared code is already JIT compiled
+        m_re = m_code.get();
+        m_tierUpTicks = 0;
+        pcre2_pattern_info(m_re, PCRE2_INFO_JITSIZE, &m_jitSize);
+        JitPerfMap::Register(m_re, m_pattern, m_flags);
 
-    pcre2_compile_context_free(compileContext);
+        if (m_stats) {
+            m_stats->SetJitSize(m_jitSize);
+        }
+    } else {
+        bool recorded = MatchRecorder::Recording();
+        std::chrono::steady_clock::time_point compileStart;
+        if (recorded) {
+            compileStart = std::chrono::steady_clock::now();
+        }
 
-    if (m_re == nullptr) {
-        PCRE2_UCHAR errorBuffer[256];
-        pcre2_get_error_message(errornumber, errorBuffer, sizeof(errorBuffer));
-        Napi::String error = Napi::String::New(info.Env(), reinterpret_cast<const char16_t*>(errorBuffer));
-        std::ostringstream oss;
-        oss << "PCRE2 compilation failed at offset " << erroroffset << ": " << error.Utf8Value();
-        throw Napi::Error::New(info.Env(), oss.str());
+        m_re = Compile(info.Env());
+        m_code = std::shared_ptr<pcre2_code>(m_re, JitPerfMap::Free);
+
+        if (recorded) {
+            MatchRecorder::RecordCompile(m_pattern, m_flags, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - compileStart).count());
+        }
+    }
+
+    if (!m_jit) {
+        m_tierUpTicks = 0;
+    }
+
+    // Plain literals are searched for directly rather than through
+    // pcre2_match, the compiled code is kept for the cases the searcher does
+    // not handle. Caseless matching of non-ASCII characters and UTF subject
+    // checks are left to PCRE2.
+    std::u16string literal;
+    if ((m_options & (PCRE2_EXTENDED | PCRE2_EXTENDED_MORE | PCRE2_UTF)) == 0 &&
+        LiteralSearcher::ParsePattern(m_pattern, literal))
+    {
+        bool caseless = (m_options & PCRE2_CASELESS) != 0;
+        if (!caseless || std::all_of(literal.begin(), literal.end(), [](char16_t c) { return c < 0x80; })) {
+            m_literal = std::make_unique<LiteralSearcher>(literal, caseless);
+        }
+    }
+
+    if (!m_redos.empty()) {
+        PatternAnalysis analysis(m_pattern, m_options);
+        if (analysis.GetRisk() != PatternAnalysis::Risk::None) {
+            if (m_redos == "reject") {
+                const PatternAnalysis::Issue &issue = analysis.Issues().front();
+                std::ostringstream oss;
+                oss << "PCRE2 pattern has " << PatternAnalysis::RiskName(issue.risk)
+                    << " backtracking risk at offset " << issue.start;
+                throw Napi::Error::New(info.Env(), oss.str());
+            }
+
+            if (m_matchLimit == 0) {
+                m_matchLimit = kRedosMatchLimit;
+            }
+        }
+    }
+
+    if (m_matchLimit != 0) {
+        m_matchContext = pcre2_match_context_create(instanceData->memoryTracker->GeneralContext());
+        if (m_matchContext == nullptr) {
+            throw Napi::Error::New(info.Env(), "PCRE2 match context allocation failed");
+        }
+        pcre2_set_match_limit(m_matchContext, m_matchLimit);
     }
 
-    m_matchData = pcre2_match_data_create_from_pattern(m_re, nullptr);
-    if (m_matchData == nullptr) {
-        pcre2_code_free(m_re);
-        throw Napi::Error::New(info.Env(), "PCRE2 match data allocation failed");
+    uint32_t captureCount;
+    pcre2_pattern_info(m_re, PCRE2_INFO_CAPTURECOUNT, &captureCount);
+    m_ovectorSize = captureCount + 1;
+
+    if (!m_pooledMatchData) {
+        m_matchData = pcre2_match_data_create(m_ovectorSize, instanceData->memoryTracker->GeneralContext());
+        if (m_matchData == nullptr) {
+            throw Napi::Error::New(info.Env(), "PCRE2 match data allocation failed");
+        }
     }
 
     uint32_t option_bits;
@@ -146,37 +321,88 @@ PCRE2::PCRE2(const Napi::CallbackInfo &info)
         newline == PCRE2_NEWLINE_CRLF ||
         newline == PCRE2_NEWLINE_ANYCRLF;
 
-    m_size = (m_pattern.size() * sizeof(char16_t)) + PatternSize(info.Env()) + pcre2_get_match_data_size(m_matchData);
+    // The code and match data are allocated through the memory tracker, so
+    // only what is allocated outside of it is accounted for here
+    m_size = m_pattern.size() * sizeof(char16_t) + m_jitSize;
+    instanceData->jitSize += m_jitSize;
     Napi::MemoryManagement::AdjustExternalMemory(info.Env(), m_size);
+    AdjustExternalMemory(info.Env());
+}
+
+pcre2_code *PCRE2::Compile(Napi::Env env, uint32_t extraOptions /* = 0 */) const {
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+
+    pcre2_compile_context *compileContext = pcre2_compile_context_copy(instanceData->compileContext);
+    pcre2_set_compile_extra_options(compileContext, m_extraOptions);
+
+    int errornumber;
+    size_t erroroffset;
+    pcre2_code *re = pcre2_compile(
+        reinterpret_cast<PCRE2_SPTR>(m_pattern.c_str()),
+        m_pattern.size(),
+        m_options | extraOptions,
+        &errornumber,
+        &erroroffset,
+        compileContext
+    );
+
+    pcre2_compile_context_free(compileContext);
+
+    if (re == nullptr) {
+        throw Napi::Error::New(env, CompileErrorMessage(errornumber, erroroffset));
+    }
+
+    return re;
+}
+
+std::string PCRE2::CompileErrorMessage(int errorCode, size_t errorOffset) {
+    PCRE2_UCHAR errorBuffer[256];
+    pcre2_get_error_message(errorCode, errorBuffer, sizeof(errorBuffer));
+    std::ostringstream oss;
+    oss << "PCRE2 compilation failed at offset " << errorOffset << ": ";
+    // Error messages are plain ASCII
+    for (PCRE2_UCHAR *p = errorBuffer; *p != 0; p++) {
+        oss << static_cast<char>(*p);
+    }
+    return oss.str();
 }
 
 PCRE2::~PCRE2() {
+    InstanceData *instanceData = Env().GetInstanceData<InstanceData>();
+
     pcre2_match_data_free(m_matchData);
-    pcre2_code_free(m_re);
+    pcre2_match_context_free(m_matchContext);
+    instanceData->jitSize -= m_jitSize;
     Napi::MemoryManagement::AdjustExternalMemory(Env(), -m_size);
+    AdjustExternalMemory(Env());
 }
 
 Napi::Value PCRE2::ExecImpl(Napi::Env env, const Napi::String &subject, uint32_t options /* = 0 */) {
+    return ExecImpl(env, subject, std::make_shared<const std::u16string>(subject.Utf16Value()), options);
+}
+
+Napi::Value PCRE2::ExecImpl(
+    Napi::Env env,
+    const Napi::String &subject,
+    const std::shared_ptr<const std::u16string> &subjectBuffer,
+    uint32_t options /* = 0 */
+) {
     Napi::EscapableHandleScope scope(env);
     InstanceData *instanceData = env.GetInstanceData<InstanceData>();
 
-    std::u16string subjectStr = subject.Utf16Value();
+    const std::u16string &subjectStr = *subjectBuffer;
 
     if (!m_global && !m_sticky) {
         m_lastIndex = 0;
     }
 
-    TierUpTick(env);
-    int rc = pcre2_match(
-        m_re,
-        reinterpret_cast<PCRE2_SPTR>(subjectStr.c_str()),
-        subjectStr.length(),
+    MatchDataScope matchDataScope(this, env);
+    int rc = MatchImpl(
+        env,
+        subjectStr,
         !m_global && !m_sticky ? 0 : m_lastIndex,
-        options | (m_sticky ? PCRE2_ANCHORED : 0),
-        m_matchData,
-        nullptr
+        options | (m_sticky ? PCRE2_ANCHORED : 0)
     );
-    AdjustMatchDataHeapFramesSize(env);
     if (rc < 0) {
         if (rc == PCRE2_ERROR_NOMATCH) {
             if (m_global || m_sticky) {
@@ -217,9 +443,7 @@ Napi::Value PCRE2::ExecImpl(Napi::Env env, const Napi::String &subject, uint32_t
             continue;
         }
 
-        const char16_t *substring_start = subjectStr.c_str() + ovector[2*i];
-        PCRE2_SIZE substring_length = ovector[2*i+1] - ovector[2*i];
-        result[i] = Napi::String::New(env, substring_start, substring_length);
+        result[i] = Substring(env, subjectBuffer, ovector[2*i], ovector[2*i+1] - ovector[2*i]);
 
         if (m_hasIndices) {
             Napi::Array indice = Napi::Array::New(env, 2);
@@ -263,7 +487,7 @@ Napi::Value PCRE2::ExecImpl(Napi::Env env, const Napi::String &subject, uint32_t
             int n = tabptr[0];
             groups.Set(
                 groupName,
-                Napi::String::New(env, subjectStr.c_str() + ovector[2*n], ovector[2*n+1] - ovector[2*n]));
+                Substring(env, subjectBuffer, ovector[2*n], ovector[2*n+1] - ovector[2*n]));
             tabptr += nameEntrySize;
 
             if (m_hasIndices) {
@@ -293,11 +517,311 @@ Napi::Value PCRE2::ExecImpl(Napi::Env env, const Napi::String &subject, uint32_t
     return scope.Escape(result);
 }
 
+int PCRE2::MatchImpl(Napi::Env env, const std::u16string &subject, size_t startOffset, uint32_t options) {
+    // Cached results skip the matcher entirely, including statistics and
+    // tracing, while calls with other options, such as retries after an
+    // empty match, always run
+    bool cached = m_matchCache && !m_profiler && (options & ~PCRE2_ANCHORED) == 0 && m_matchCache->Accepts(subject);
+    if (cached) {
+        int rc;
+        if (m_matchCache->Lookup(subject, startOffset, options, m_matchData, rc)) {
+            return rc;
+        }
+    }
+
+    bool literal = m_literal && !m_profiler && (options & ~PCRE2_ANCHORED) == 0;
+    if (!literal) {
+        TierUpTick(env);
+    }
+
+    SlowMatchTracer *tracer = env.GetInstanceData<InstanceData>()->slowMatchTracer;
+    std::chrono::steady_clock::time_point traceStart;
+    bool traced = tracer->StartCall(traceStart);
+
+    std::chrono::steady_clock::time_point recordStart;
+    bool recorded = MatchRecorder::Sample();
+    if (recorded) {
+        recordStart = std::chrono::steady_clock::now();
+    }
+
+    std::chrono::steady_clock::time_point start;
+    bool timed = m_stats && m_stats->StartCall(start);
+
+    int rc;
+    bool jit = false;
+    if (literal) {
+        rc = LiteralMatch(subject, startOffset, options);
+    } else {
+        pcre2_code *re = m_re;
+        pcre2_match_context *matchContext = m_matchContext;
+        if (m_profiler) {
+            re = m_profiler->Code();
+            matchContext = m_profiler->MatchContext();
+            m_profiler->AddCall();
+        } else if (m_deadline && m_deadline->Active()) {
+            re = m_deadline->Code();
+            matchContext = m_deadline->MatchContext();
+        }
+        // The deadline's copy is always JIT compiled, the profiler's never
+        jit = !m_profiler && (re != m_re || m_jitSize > 0);
+
+        rc = pcre2_match(
+            re,
+            reinterpret_cast<PCRE2_SPTR>(subject.c_str()),
+            subject.length(),
+            startOffset,
+            options,
+            m_matchData,
+            matchContext
+        );
+    }
+
+    if (m_stats) {
+        m_stats->EndCall(rc, subject.length() - std::min(startOffset, subject.length()), timed, start);
+        m_stats->SetHeapFramesSize(pcre2_get_match_data_heapframes_size(m_matchData));
+    }
+
+    if (traced) {
+        tracer->EndCall(env, traceStart, { "match", m_pattern, m_flags, subject.length(), startOffset, jit, rc });
+    }
+
+    if (recorded) {
+        MatchRecorder::RecordMatch({
+            0, m_pattern, m_flags, subject, startOffset, options, nullptr, rc, jit,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - recordStart).count()),
+        });
+    }
+
+    if (cached) {
+        m_matchCache->Store(subject, startOffset, options, m_matchData, rc);
+    }
+
+    AdjustExternalMemory(env);
+    ThrowIfTimedOut(env, rc);
+    return rc;
+}
+
+int PCRE2::SubstituteImpl(
+    Napi::Env env,
+    const std::u16string &subject,
+    const std::u16string &replacement,
+    size_t startOffset,
+    uint32_t options,
+    std::vector<PCRE2_UCHAR> &outputBuffer,
+    PCRE2_SIZE &outputLength)
+{
+    // Without a $ the replacement is inserted as is
+    bool literal =
+        m_literal && !m_profiler && startOffset == 0 &&
+        (options & ~PCRE2_SUBSTITUTE_GLOBAL) == 0 &&
+        replacement.find(u'$') == std::u16string::npos;
+    if (!literal) {
+        TierUpTick(env);
+    }
+
+    SlowMatchTracer *tracer = env.GetInstanceData<InstanceData>()->slowMatchTracer;
+    std::chrono::steady_clock::time_point traceStart;
+    bool traced = tracer->StartCall(traceStart);
+
+    std::chrono::steady_clock::time_point recordStart;
+    bool recorded = MatchRecorder::Sample();
+    if (recorded) {
+        recordStart = std::chrono::steady_clock::now();
+    }
+    auto record = [&](int rc, bool jit) {
+        MatchRecorder::RecordMatch({
+            1, m_pattern, m_flags, subject, startOffset, options, &replacement, rc, jit,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - recordStart).count()),
+        });
+    };
+
+    std::chrono::steady_clock::time_point start;
+    bool timed = m_stats && m_stats->StartCall(start);
+
+    if (literal) {
+        int rc = LiteralSubstitute(subject, replacement, options, outputBuffer, outputLength);
+        if (m_stats) {
+            m_stats->EndCall(rc, subject.length(), timed, start);
+        }
+        if (traced) {
+            tracer->EndCall(env, traceStart, { "substitute", m_pattern, m_flags, subject.length(), startOffset, false, rc });
+        }
+        if (recorded) {
+            record(rc, false);
+        }
+        return rc;
+    }
+
+    pcre2_code *re = m_re;
+    pcre2_match_context *matchContext = m_matchContext;
+    if (m_profiler) {
+        re = m_profiler->Code();
+        matchContext = m_profiler->MatchContext();
+        m_profiler->AddCall();
+    } else if (m_deadline && m_deadline->Active()) {
+        re = m_deadline->Code();
+        matchContext = m_deadline->MatchContext();
+    }
+
+    outputBuffer.resize(subject.size() + (subject.size() / 2));
+
+    int rc;
+    while (true) {
+        outputLength = outputBuffer.size();
+        rc = pcre2_substitute(
+            re,
+            reinterpret_cast<PCRE2_SPTR16>(subject.c_str()),
+            subject.length(),
+            startOffset,
+            options | PCRE2_SUBSTITUTE_OVERFLOW_LENGTH,
+            m_matchData,
+            matchContext,
+            reinterpret_cast<PCRE2_SPTR16>(replacement.c_str()),
+            replacement.length(),
+            outputBuffer.data(),
+            &outputLength
+        );
+        if (rc == PCRE2_ERROR_NOMEMORY) {
+            outputBuffer.resize(outputLength);
+            continue;
+        }
+
+        break;
+    }
+
+    if (m_stats) {
+        m_stats->EndCall(rc, subject.length(), timed, start);
+        m_stats->SetHeapFramesSize(pcre2_get_match_data_heapframes_size(m_matchData));
+    }
+
+    bool jit = !m_profiler && (re != m_re || m_jitSize > 0);
+    if (traced) {
+        tracer->EndCall(env, traceStart, { "substitute", m_pattern, m_flags, subject.length(), startOffset, jit, rc });
+    }
+    if (recorded) {
+        record(rc, jit);
+    }
+
+    AdjustExternalMemory(env);
+    ThrowIfTimedOut(env, rc);
+    return rc;
+}
+
+Napi::String PCRE2::Substring(
+    Napi::Env env,
+    const std::shared_ptr<const std::u16string> &subjectBuffer,
+    size_t start,
+    size_t length
+) const {
+    if (m_externalStrings) {
+        return ExternalString::New(env, subjectBuffer, start, length);
+    }
+
+    return Napi::String::New(env, subjectBuffer->data() + start, length);
+}
+
+double PCRE2::CallTimeout(const Napi::CallbackInfo &info, size_t index) const {
+    if (info.Length() > index && info[index].IsObject()) {
+        Napi::Value timeoutMs = info[index].As<Napi::Object>().Get("timeoutMs");
+        if (!timeoutMs.IsUndefined()) {
+            return ReadTimeoutOption(info.Env(), timeoutMs);
+        }
+    }
+
+    return m_timeoutMs;
+}
+
+MatchDeadline *PCRE2::Deadline(Napi::Env env) {
+    if (!m_deadline) {
+        m_deadline = std::make_shared<MatchDeadline>(
+            env,
+            Compile(env, PCRE2_AUTO_CALLOUT),
+            env.GetInstanceData<InstanceData>()->memoryTracker->GeneralContext(),
+            m_matchLimit
+        );
+        JitPerfMap::Register(m_deadline->Code(), m_pattern, m_flags + " [timeout]");
+    }
+
+    return m_deadline.get();
+}
+
+void PCRE2::ThrowIfTimedOut(Napi::Env env, int rc) const {
+    if (rc != PCRE2_ERROR_CALLOUT || !m_deadline || !m_deadline->Expired()) {
+        return;
+    }
+
+    std::ostringstream oss;
+    oss << "PCRE2 match timed out after " << m_deadline->TimeoutMs() << "ms";
+    Napi::Error error = Napi::Error::New(env, oss.str());
+    error.Set("code", Napi::String::New(env, "ERR_PCRE2_TIMEOUT"));
+    throw error;
+}
+
+int PCRE2::LiteralMatch(const std::u16string &subject, size_t startOffset, uint32_t options) {
+    if (startOffset > subject.length()) {
+        return PCRE2_ERROR_BADOFFSET;
+    }
+
+    size_t offset;
+    if (options & PCRE2_ANCHORED) {
+        offset = m_literal->MatchesAt(subject.data(), subject.length(), startOffset) ? startOffset : LiteralSearcher::npos;
+    } else {
+        offset = m_literal->Find(subject.data(), subject.length(), startOffset);
+    }
+
+    if (offset == LiteralSearcher::npos) {
+        return PCRE2_ERROR_NOMATCH;
+    }
+
+    // Filled in the same way pcre2_match would, so callers read the result
+    // from the match data either way
+    PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(m_matchData);
+    ovector[0] = offset;
+    ovector[1] = offset + m_literal->Length();
+    return 1;
+}
+
+int PCRE2::LiteralSubstitute(
+    const std::u16string &subject,
+    const std::u16string &replacement,
+    uint32_t options,
+    std::vector<PCRE2_UCHAR> &outputBuffer,
+    PCRE2_SIZE &outputLength)
+{
+    outputBuffer.clear();
+    outputBuffer.reserve(subject.size() + 1);
+
+    int count = 0;
+    size_t position = 0;
+    while (true) {
+        size_t offset = m_literal->Find(subject.data(), subject.length(), position);
+        if (offset == LiteralSearcher::npos) {
+            break;
+        }
+
+        outputBuffer.insert(outputBuffer.end(), subject.begin() + position, subject.begin() + offset);
+        outputBuffer.insert(outputBuffer.end(), replacement.begin(), replacement.end());
+        position = offset + m_literal->Length();
+        count++;
+
+        if (!(options & PCRE2_SUBSTITUTE_GLOBAL)) {
+            break;
+        }
+    }
+
+    outputBuffer.insert(outputBuffer.end(), subject.begin() + position, subject.end());
+    outputLength = outputBuffer.size();
+    return count;
+}
+
 Napi::Value PCRE2::Exec(const Napi::CallbackInfo &info) {
     if (info.Length() < 1) {
         throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
     }
 
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
     return ExecImpl(info.Env(), info[0].ToString());
 }
 
@@ -313,18 +837,10 @@ Napi::Value PCRE2::Test(const Napi::CallbackInfo &info) {
         m_lastIndex = 0;
     }
 
-    TierUpTick(info.Env());
-    int rc = pcre2_match(
-        m_re,
-        reinterpret_cast<PCRE2_SPTR>(subjectStr.c_str()),
-        subjectStr.length(),
-        m_lastIndex,
-        m_sticky ? PCRE2_ANCHORED : 0,
-        // TODO I think it is possible to use a smaller pcre2_match_data so it doesn't fill in ovector for performance
-        m_matchData,
-        nullptr
-    );
-    AdjustMatchDataHeapFramesSize(info.Env());
+    // TODO I think it is possible to use a smaller pcre2_match_data so it doesn't fill in ovector for performance
+    MatchDataScope matchDataScope(this, info.Env());
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
+    int rc = MatchImpl(info.Env(), subjectStr, m_lastIndex, m_sticky ? PCRE2_ANCHORED : 0);
     if (rc < 0) {
         if (rc == PCRE2_ERROR_NOMATCH) {
             m_lastIndex = 0;
@@ -348,6 +864,159 @@ Napi::Value PCRE2::Test(const Napi::CallbackInfo &info) {
     return Napi::Boolean::New(info.Env(), true);
 }
 
+// Tests the whole subject like filterParallel does, leaving lastIndex alone
+bool PCRE2::TestSubject(Napi::Env env, const std::u16string &subject) {
+    MatchDataScope matchDataScope(this, env);
+    DeadlineScope deadlineScope(this, env, m_timeoutMs);
+    int rc = MatchImpl(env, subject, 0, m_sticky ? PCRE2_ANCHORED : 0);
+    if (rc < 0) {
+        if (rc == PCRE2_ERROR_NOMATCH) {
+            return false;
+        }
+        ThrowMatchError(env, rc);
+    }
+
+    return true;
+}
+
+// Matches at start only, rejecting an empty match, for tokenizing. Returns
+// false when nothing matches there, otherwise sets the end of the match and
+// the name of the last (*MARK) passed, or nullptr.
+bool PCRE2::MatchToken(Napi::Env env, const std::u16string &subject, size_t start, size_t &end, PCRE2_SPTR &mark) {
+    MatchDataScope matchDataScope(this, env);
+    DeadlineScope deadlineScope(this, env, m_timeoutMs);
+    int rc = MatchImpl(env, subject, start, PCRE2_ANCHORED | PCRE2_NOTEMPTY_ATSTART);
+    if (rc < 0) {
+        if (rc == PCRE2_ERROR_NOMATCH) {
+            return false;
+        }
+        ThrowMatchError(env, rc);
+    }
+
+    end = pcre2_get_ovector_pointer(m_matchData)[1];
+    mark = pcre2_get_mark(m_matchData);
+    return true;
+}
+
+// Finds the next match of a global scan from state, handling empty matches
+// the way matchAll does, and advances state past it. Returns false once the
+// scan is done.
+bool PCRE2::ScanNext(Napi::Env env, const std::u16string &subject, ScanState &state, size_t &start, size_t &end) {
+    MatchDataScope matchDataScope(this, env);
+    DeadlineScope deadlineScope(this, env, m_timeoutMs);
+
+    while (!state.done) {
+        uint32_t options = m_sticky ? PCRE2_ANCHORED : 0;
+        if (state.notEmpty) {
+            options |= PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+        }
+
+        int rc = MatchImpl(env, subject, state.cursor, options);
+        if (rc == PCRE2_ERROR_NOMATCH) {
+            if (!state.notEmpty) {
+                state.done = true;
+                break;
+            }
+            state.notEmpty = false;
+            state.cursor = AdvanceStringIndex(subject, state.cursor);
+            continue;
+        }
+        if (rc < 0) {
+            ThrowMatchError(env, rc);
+        }
+
+        PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(m_matchData);
+        start = ovector[0];
+        end = ovector[1];
+
+        state.cursor = end;
+        state.notEmpty = false;
+        if (start == end) {
+            if (end == subject.length()) {
+                state.done = true;
+            } else if (m_pcre2) {
+                state.notEmpty = true;
+            } else {
+                state.cursor = AdvanceStringIndex(subject, end);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// In code units, PCRE2 counts characters in UTF mode
+size_t PCRE2::MaxLookbehind() const {
+    uint32_t lookbehind = 0;
+    pcre2_pattern_info(m_re, PCRE2_INFO_MAXLOOKBEHIND, &lookbehind);
+    return (m_options & PCRE2_UTF) != 0 ? lookbehind * 2 : lookbehind;
+}
+
+size_t PCRE2::MaxReach() const {
+    return PatternAnalysis(m_pattern, m_options).MaxReach();
+}
+
+// Literals one of which is in every match, up to ASCII case, or none when
+// nothing is known
+std::vector<std::u16string> PCRE2::FilterLiterals() const {
+    std::vector<std::u16string> literals = RequiredLiterals(m_pattern, m_options).Literals();
+    if (!literals.empty()) {
+        return literals;
+    }
+
+    // PCRE2 finds a required first or last code unit in more patterns, but
+    // doesn't tell whether it is caseless. That only matters beyond ASCII,
+    // and for K and S which fold with non-ASCII signs in Unicode mode.
+    bool unicode = (m_options & (PCRE2_UTF | PCRE2_UCP)) != 0;
+    const uint32_t infos[][2] = {
+        { PCRE2_INFO_FIRSTCODETYPE, PCRE2_INFO_FIRSTCODEUNIT },
+        { PCRE2_INFO_LASTCODETYPE, PCRE2_INFO_LASTCODEUNIT },
+    };
+    for (const auto &info : infos) {
+        uint32_t type = 0;
+        uint32_t unit = 0;
+        pcre2_pattern_info(m_re, info[0], &type);
+        if (type != 1) {
+            continue;
+        }
+
+        pcre2_pattern_info(m_re, info[1], &unit);
+        uint32_t lower = unit | 0x20;
+        if (unit < 0x80 && !(unicode && (lower == 'k' || lower == 's'))) {
+            literals.emplace_back(1, static_cast<char16_t>(unit));
+            break;
+        }
+    }
+
+    return literals;
+}
+
+// The number and name of each named group, from the name table
+std::vector<std::pair<uint32_t, std::u16string>> PCRE2::GroupNames() const {
+    uint32_t nameCount;
+    PCRE2_SPTR nameTable;
+    uint32_t nameEntrySize;
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMECOUNT, &nameCount);
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMETABLE, &nameTable);
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMEENTRYSIZE, &nameEntrySize);
+
+    std::vector<std::pair<uint32_t, std::u16string>> names;
+    for (uint32_t i = 0; i < nameCount; i++, nameTable += nameEntrySize) {
+        names.emplace_back(nameTable[0], reinterpret_cast<const char16_t*>(nameTable + 1));
+    }
+    return names;
+}
+
+void PCRE2::ThrowMatchError(Napi::Env env, int rc) {
+    PCRE2_UCHAR errorBuffer[256];
+    pcre2_get_error_message(rc, errorBuffer, sizeof(errorBuffer));
+    Napi::String error = Napi::String::New(env, reinterpret_cast<const char16_t*>(errorBuffer));
+    std::ostringstream oss;
+    oss << "PCRE2 matching error " << rc << ": " << error.Utf8Value();
+    throw Napi::Error::New(env, oss.str());
+}
+
 Napi::Value PCRE2::ToString(const Napi::CallbackInfo &info) {
     std::ostringstream oss;
 
@@ -371,17 +1040,20 @@ Napi::Value PCRE2::Match(const Napi::CallbackInfo &info) {
     }
 
     Napi::String subject = info[0].ToString();
-    std::u16string subjectStr = subject.Utf16Value();
+    auto subjectBuffer = std::make_shared<const std::u16string>(subject.Utf16Value());
+    const std::u16string &subjectStr = *subjectBuffer;
 
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
     if (!m_global) {
-        return ExecImpl(info.Env(), subject);
+        return ExecImpl(info.Env(), subject, subjectBuffer);
     }
 
     m_lastIndex = 0;
     uint32_t options = 0;
     Napi::Array result = Napi::Array::New(info.Env());
+    MatchDataScope matchDataScope(this, info.Env());
     while (true) {
-        Napi::Array match = ExecImpl(info.Env(), subject, options).As<Napi::Array>();
+        Napi::Array match = ExecImpl(info.Env(), subject, subjectBuffer, options).As<Napi::Array>();
         if (match.IsNull()) {
             if (result.Length() == 0) {
                 return info.Env().Null();
@@ -424,11 +1096,10 @@ Napi::Value PCRE2::Search(const Napi::CallbackInfo &info) {
     Napi::String subject = info[0].ToString();
     std::u16string subjectStr = subject.Utf16Value();
 
-    size_t lastIndex = m_lastIndex;
-
+    LastIndexScope lastIndexScope(this);
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
     m_lastIndex = 0;
     Napi::Array match = ExecImpl(info.Env(), subject).As<Napi::Array>();
-    m_lastIndex = lastIndex;
     if (match.IsNull()) {
         return Napi::Number::New(info.Env(), -1);
     }
@@ -443,7 +1114,8 @@ Napi::Value PCRE2::Split(const Napi::CallbackInfo &info) {
         throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
     }
     Napi::String subject = info[0].ToString();
-    std::u16string subjectStr = subject.Utf16Value();
+    auto subjectBuffer = std::make_shared<const std::u16string>(subject.Utf16Value());
+    const std::u16string &subjectStr = *subjectBuffer;
 
     uint32_t limit = UINT32_MAX;
     if (info.Length() >= 2 && !info[1].IsUndefined()) {
@@ -455,15 +1127,23 @@ Napi::Value PCRE2::Split(const Napi::CallbackInfo &info) {
         return result;
     }
 
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 2));
     Napi::Function speciesCtor = SpeciesConstructor(info.Env(), Value(), instanceData->PCRE2.Value());
     std::string newFlags = m_flags;
     if (m_flags.find("y") == -1) {
         newFlags += "y";
     }
     PCRE2 *splitter = PCRE2::Unwrap(speciesCtor.New({ Value(), Napi::String::New(info.Env(), newFlags) }));
+    // Attribute the splitter's calls to this pattern
+    splitter->m_stats = m_stats;
+    splitter->m_profiler = m_profiler;
+    splitter->m_deadline = m_deadline;
+    // Splitting matches anchored at every position, which would only fill
+    // the cache with results that are never looked up again
+    splitter->m_matchCache.reset();
 
     if (subjectStr.empty()) {
-        Napi::Array match = splitter->ExecImpl(info.Env(), subject).As<Napi::Array>();
+        Napi::Array match = splitter->ExecImpl(info.Env(), subject, subjectBuffer).As<Napi::Array>();
         if (match.IsNull()) {
             return result;
         }
@@ -477,7 +1157,7 @@ Napi::Value PCRE2::Split(const Napi::CallbackInfo &info) {
 
     while (q < subjectStr.size()) {
         splitter->m_lastIndex = q;
-        Napi::Array match = splitter->ExecImpl(info.Env(), subject).As<Napi::Array>();
+        Napi::Array match = splitter->ExecImpl(info.Env(), subject, subjectBuffer).As<Napi::Array>();
         if (match.IsNull()) {
             q = splitter->AdvanceStringIndex(subjectStr, q);
         } else {
@@ -485,7 +1165,7 @@ Napi::Value PCRE2::Split(const Napi::CallbackInfo &info) {
             if (e == p) {
                 q = splitter->AdvanceStringIndex(subjectStr, q);
             } else {
-                instanceData->ArrayPush.Call(result, { Napi::String::New(info.Env(), subjectStr.c_str() + p, q - p) });
+                instanceData->ArrayPush.Call(result, { Substring(info.Env(), subjectBuffer, p, q - p) });
                 if (result.Length() == limit) {
                     return result;
                 }
@@ -505,7 +1185,7 @@ Napi::Value PCRE2::Split(const Napi::CallbackInfo &info) {
         }
     }
 
-    instanceData->ArrayPush.Call(result, { Napi::String::New(info.Env(), subjectStr.c_str() + p, subjectStr.size() - p) });
+    instanceData->ArrayPush.Call(result, { Substring(info.Env(), subjectBuffer, p, subjectStr.size() - p) });
     return result;
 }
 
@@ -514,6 +1194,9 @@ Napi::Value PCRE2::MatchAll(const Napi::CallbackInfo &info) {
 
     Napi::Function speciesCtor = SpeciesConstructor(info.Env(), Value(), instanceData->PCRE2.Value());
     PCRE2 *matcher = PCRE2::Unwrap(speciesCtor.New({ Value(), Napi::String::New(info.Env(), m_flags) }));
+    matcher->m_stats = m_stats;
+    matcher->m_profiler = m_profiler;
+    matcher->m_matchCache = m_matchCache;
     matcher->m_lastIndex = m_lastIndex;
 
     return instanceData->PCRE2StringIterator.New({ matcher->Value(), info[0] });
@@ -533,42 +1216,32 @@ Napi::Value PCRE2::Replace(const Napi::CallbackInfo &info) {
         m_lastIndex = 0;
     }
 
+    MatchDataScope matchDataScope(this, info.Env());
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 2));
     if (!info[1].IsFunction()) {
         Napi::String replacement = info[1].ToString();
         std::u16string replacementStr = replacement.Utf16Value();
-        std::vector<PCRE2_UCHAR> outputBuffer(subjectStr.size() + (subjectStr.size() / 2));
-
-        while (true) {
-            PCRE2_SIZE outputBufferSize = outputBuffer.size();
-            int rc = pcre2_substitute(
-                m_re,
-                reinterpret_cast<PCRE2_SPTR16>(subjectStr.c_str()),
-                subjectStr.length(),
-                0,
-                PCRE2_SUBSTITUTE_OVERFLOW_LENGTH | (m_global ? PCRE2_SUBSTITUTE_GLOBAL : 0),
-                m_matchData,
-                nullptr,
-                reinterpret_cast<PCRE2_SPTR16>(replacementStr.c_str()),
-                replacementStr.length(),
-                outputBuffer.data(),
-                &outputBufferSize
-            );
-            if (rc < 0) {
-                if (rc == PCRE2_ERROR_NOMEMORY) {
-                    outputBuffer.resize(outputBufferSize);
-                    continue;
-                }
-
-                PCRE2_UCHAR errorBuffer[256];
-                pcre2_get_error_message(rc, errorBuffer, sizeof(errorBuffer));
-                Napi::String error = Napi::String::New(info.Env(), reinterpret_cast<const char16_t*>(errorBuffer));
-                std::ostringstream oss;
-                oss << "PCRE2 substituion error " << rc << ": " << error.Utf8Value();
-                throw Napi::Error::New(info.Env(), oss.str());
-            }
-
-            return Napi::String::New(info.Env(), reinterpret_cast<const char16_t*>(outputBuffer.data()), outputBufferSize);
+        std::vector<PCRE2_UCHAR> outputBuffer;
+        PCRE2_SIZE outputLength;
+        int rc = SubstituteImpl(
+            info.Env(),
+            subjectStr,
+            replacementStr,
+            0,
+            m_global ? PCRE2_SUBSTITUTE_GLOBAL : 0,
+            outputBuffer,
+            outputLength
+        );
+        if (rc < 0) {
+            PCRE2_UCHAR errorBuffer[256];
+            pcre2_get_error_message(rc, errorBuffer, sizeof(errorBuffer));
+            Napi::String error = Napi::String::New(info.Env(), reinterpret_cast<const char16_t*>(errorBuffer));
+            std::ostringstream oss;
+            oss << "PCRE2 substituion error " << rc << ": " << error.Utf8Value();
+            throw Napi::Error::New(info.Env(), oss.str());
         }
+
+        return Napi::String::New(info.Env(), reinterpret_cast<const char16_t*>(outputBuffer.data()), outputLength);
     } else {
         Napi::Function replacer = info[1].As<Napi::Function>();
         std::u16string result;
@@ -632,105 +1305,499 @@ Napi::Value PCRE2::Replace(const Napi::CallbackInfo &info) {
     }
 }
 
-Napi::Value PCRE2::GetLastIndex(const Napi::CallbackInfo &info) {
-    return Napi::Number::New(info.Env(), m_lastIndex);
-}
+Napi::Value PCRE2::FilterPaths(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
 
-void PCRE2::SetLastIndex(const Napi::CallbackInfo &info, const Napi::Value &value) {
-    if (!value.IsNumber()) {
-        throw Napi::TypeError::New(info.Env(), "Expected a number");
+    if (!info[0].IsArray()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of strings");
     }
+    Napi::Array paths = info[0].As<Napi::Array>();
 
-    m_lastIndex = value.As<Napi::Number>().Int64Value();
-}
+    MatchDataScope matchDataScope(this, info.Env());
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
+    EnsureJit(info.Env());
 
-void PCRE2::ParseFlags(Napi::Env env, const std::string &flags) {
-    for (std::string::const_iterator i = flags.cbegin(); i != flags.cend(); i++) {
-        switch (*i) {
-            case 'd':
-                m_hasIndices = true;
+    std::u16string path;
+    std::vector<uint32_t> matched;
+    uint32_t length = paths.Length();
+    for (uint32_t i = 0; i < length; i++) {
+        ReadString(info.Env(), paths.Get(i), path);
+
+        int rc = MatchImpl(info.Env(), path, 0, m_sticky ? PCRE2_ANCHORED : 0);
+        if (rc < 0) {
+            if (rc == PCRE2_ERROR_NOMATCH) {
+                continue;
+            }
+            ThrowMatchError(info.Env(), rc);
+        }
+
+        matched.push_back(i);
+    }
+
+    Napi::Uint32Array result = Napi::Uint32Array::New(info.Env(), matched.size());
+    std::copy(matched.begin(), matched.end(), result.Data());
+    return result;
+}
+
+Napi::Value PCRE2::ExtractColumns(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    if (!info[0].IsArray() && !info[0].IsString()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of strings or a string");
+    }
+
+    bool offsets = false;
+    Napi::Value groupsValue = info.Env().Undefined();
+    if (info.Length() > 1 && !info[1].IsUndefined()) {
+        Napi::Object options = info[1].ToObject();
+        offsets = options.Get("offsets").ToBoolean();
+        groupsValue = options.Get("groups");
+    }
+
+    // The name table is resolved once for the whole batch. Its entries are
+    // sorted by name, with duplicate names in group number order.
+    uint32_t nameCount;
+    PCRE2_SPTR nameTable;
+    uint32_t nameEntrySize;
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMECOUNT, &nameCount);
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMETABLE, &nameTable);
+    pcre2_pattern_info(m_re, PCRE2_INFO_NAMEENTRYSIZE, &nameEntrySize);
+
+    struct Column {
+        std::u16string name;
+        // With duplicate names, the first of these groups that is set
+        std::vector<uint32_t> groups;
+    };
+    std::vector<Column> columns;
+    auto findColumn = [&](const std::u16string &name) -> Column* {
+        for (Column &column : columns) {
+            if (column.name == name) {
+                return &column;
+            }
+        }
+        return nullptr;
+    };
+
+    PCRE2_SPTR tabptr = nameTable;
+    for (uint32_t i = 0; i < nameCount; i++, tabptr += nameEntrySize) {
+        std::u16string name(reinterpret_cast<const char16_t*>(tabptr + 1));
+        Column *column = findColumn(name);
+        if (!column) {
+            columns.push_back({ name, {} });
+            column = &columns.back();
+        }
+        column->groups.push_back(tabptr[0]);
+    }
+
+    if (!groupsValue.IsUndefined()) {
+        if (!groupsValue.IsArray()) {
+            throw Napi::TypeError::New(info.Env(), "Expected groups to be an array of group names");
+        }
+        Napi::Array groups = groupsValue.As<Napi::Array>();
+        std::vector<Column> selected;
+        for (uint32_t i = 0; i < groups.Length(); i++) {
+            Napi::String name = groups.Get(i).ToString();
+            Column *column = findColumn(name.Utf16Value());
+            if (!column) {
+                throw Napi::Error::New(info.Env(), "Unknown group name '" + name.Utf8Value() + "'");
+            }
+            selected.push_back(*column);
+        }
+        columns = std::move(selected);
+    }
+
+    // A string is split into lines, without their line terminators, and the
+    // offsets are then into the whole string
+    std::u16string text;
+    std::vector<size_t> lineStarts;
+    std::vector<size_t> lineEnds;
+    Napi::Array lines;
+    uint32_t lineCount;
+    if (info[0].IsString()) {
+        text = info[0].As<Napi::String>().Utf16Value();
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t newline = text.find(u'\n', start);
+            size_t next = newline == std::u16string::npos ? text.size() : newline + 1;
+            size_t end = newline == std::u16string::npos ? text.size() : newline;
+            if (end > start && text[end - 1] == u'\r') {
+                end--;
+            }
+            lineStarts.push_back(start);
+            lineEnds.push_back(end);
+            start = next;
+        }
+        lineCount = static_cast<uint32_t>(lineStarts.size());
+    } else {
+        lines = info[0].As<Napi::Array>();
+        lineCount = lines.Length();
+    }
+
+    std::vector<uint8_t> matched((lineCount + 7) / 8);
+    std::vector<std::vector<int32_t>> columnOffsets(offsets ? columns.size() : 0);
+    std::vector<Napi::Array> columnStrings;
+    for (size_t i = 0; !offsets && i < columns.size(); i++) {
+        columnStrings.push_back(Napi::Array::New(info.Env(), lineCount));
+    }
+    for (std::vector<int32_t> &column : columnOffsets) {
+        column.assign(2 * static_cast<size_t>(lineCount), -1);
+    }
+
+    MatchDataScope matchDataScope(this, info.Env());
+    DeadlineScope deadlineScope(this, info.Env(), CallTimeout(info, 1));
+    EnsureJit(info.Env());
+
+    std::u16string line;
+    for (uint32_t i = 0; i < lineCount; i++) {
+        size_t base = 0;
+        if (lines.IsEmpty()) {
+            base = lineStarts[i];
+            line.assign(text, base, lineEnds[i] - base);
+        } else {
+            ReadString(info.Env(), lines.Get(i), line);
+        }
+
+        int rc = MatchImpl(info.Env(), line, 0, m_sticky ? PCRE2_ANCHORED : 0);
+        if (rc < 0 && rc != PCRE2_ERROR_NOMATCH) {
+            ThrowMatchError(info.Env(), rc);
+        }
+
+        if (rc >= 0) {
+            matched[i / 8] |= 1 << (i % 8);
+        }
+
+        PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(m_matchData);
+        for (size_t c = 0; c < columns.size(); c++) {
+            int n = -1;
+            for (uint32_t group : columns[c].groups) {
+                if (rc >= 0 && static_cast<int>(group) < rc && ovector[2*group] != PCRE2_UNSET) {
+                    n = group;
+                    break;
+                }
+            }
+
+            if (offsets) {
+                if (n >= 0) {
+                    columnOffsets[c][2*i] = static_cast<int32_t>(base + ovector[2*n]);
+                    columnOffsets[c][2*i+1] = static_cast<int32_t>(base + ovector[2*n+1]);
+                }
+            } else if (n >= 0) {
+                columnStrings[c][i] = Napi::String::New(
+                    info.Env(), &line[ovector[2*n]], ovector[2*n+1] - ovector[2*n]);
+            } else {
+                columnStrings[c][i] = info.Env().Undefined();
+            }
+        }
+    }
+
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+    Napi::Object columnsObject = instanceData->ObjectCreate.Call({ info.Env().Null() }).As<Napi::Object>();
+    for (size_t c = 0; c < columns.size(); c++) {
+        Napi::String name = Napi::String::New(info.Env(), columns[c].name);
+        if (offsets) {
+            Napi::Int32Array array = Napi::Int32Array::New(info.Env(), columnOffsets[c].size());
+            std::copy(columnOffsets[c].begin(), columnOffsets[c].end(), array.Data());
+            columnsObject.Set(name, array);
+        } else {
+            columnsObject.Set(name, columnStrings[c]);
+        }
+    }
+
+    Napi::Uint8Array matchedArray = Napi::Uint8Array::New(info.Env(), matched.size());
+    std::copy(matched.begin(), matched.end(), matchedArray.Data());
+
+    Napi::Object result = Napi::Object::New(info.Env());
+    result["length"] = lineCount;
+    result["matched"] = matchedArray;
+    result["columns"] = columnsObject;
+    return result;
+}
+
+Napi::Value PCRE2::FilterParallel(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    if (!info[0].IsArray()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of strings");
+    }
+    Napi::Array strings = info[0].As<Napi::Array>();
+
+    size_t threads = std::thread::hardware_concurrency();
+    Napi::Value signal = info.Env().Undefined();
+    if (info.Length() >= 2 && !info[1].IsUndefined()) {
+        Napi::Object options = info[1].ToObject();
+        Napi::Value threadsValue = options.Get("threads");
+        if (!threadsValue.IsUndefined()) {
+            threads = ReadCountOption(info.Env(), threadsValue, "threads", UINT32_MAX, 1);
+        }
+        signal = options.Get("signal");
+    }
+
+    if (signal.IsObject() && signal.As<Napi::Object>().Get("aborted").ToBoolean()) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(info.Env());
+        deferred.Reject(signal.As<Napi::Object>().Get("reason"));
+        return deferred.Promise();
+    }
+
+    // The workers share m_re, so it must be done with JIT compilation before they start
+    EnsureJit(info.Env());
+
+    std::shared_ptr<PCRE2FilterJob> job = std::make_shared<PCRE2FilterJob>(
+        info.Env(), Value(), m_re, m_sticky ? PCRE2_ANCHORED : 0);
+    job->matchLimit = m_matchLimit;
+
+    uint32_t length = strings.Length();
+    job->subjects.reserve(length);
+    for (uint32_t i = 0; i < length; i++) {
+        job->subjects.push_back(strings.Get(i).ToString().Utf16Value());
+    }
+
+    if (signal.IsObject() && length > 0) {
+        // Matching with callouts lets a long running match notice the abort
+        job->re = Deadline(info.Env())->Code();
+        job->calloutCode = m_deadline;
+        PCRE2FilterWorker::WatchSignal(info.Env(), job, signal.As<Napi::Object>());
+    }
+
+    return PCRE2FilterWorker::Start(info.Env(), job, threads);
+}
+
+Napi::Value PCRE2::Share(const Napi::CallbackInfo &info) {
+    // Other threads may match using the code, so it must be done with JIT compilation
+    EnsureJit(info.Env());
+
+    uint64_t id = SharedCodeRegistry::Share({ m_code, m_pattern, m_flags });
+    return Napi::Number::New(info.Env(), static_cast<double>(id));
+}
+
+Napi::Value PCRE2::MemoryUsage(const Napi::CallbackInfo &info) {
+    Napi::Object result = Napi::Object::New(info.Env());
+    size_t pattern = m_pattern.size() * sizeof(char16_t);
+    size_t code = PatternSize(info.Env());
+    size_t matchData = m_matchData != nullptr ? pcre2_get_match_data_size(m_matchData) : 0;
+    size_t heapframes = m_matchData != nullptr ? pcre2_get_match_data_heapframes_size(m_matchData) : 0;
+    result["pattern"] = pattern;
+    result["code"] = code;
+    result["jit"] = m_jitSize;
+    result["matchData"] = matchData;
+    size_t matchCache = m_matchCache ? m_matchCache->MemorySize() : 0;
+    result["heapframes"] = heapframes;
+    result["matchCache"] = matchCache;
+    result["total"] = pattern + code + m_jitSize + matchData + heapframes + matchCache;
+    return result;
+}
+
+Napi::Value PCRE2::Stats(const Napi::CallbackInfo &info) {
+    if (!m_stats) {
+        return info.Env().Undefined();
+    }
+
+    return m_stats->ToObject(info.Env());
+}
+
+Napi::Value PCRE2::MatchCacheStats(const Napi::CallbackInfo &info) {
+    if (!m_matchCache) {
+        return info.Env().Undefined();
+    }
+
+    return m_matchCache->ToObject(info.Env());
+}
+
+Napi::Value PCRE2::StartProfiling(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    m_profiler = std::make_shared<PatternProfiler>(
+        Compile(info.Env(), PCRE2_AUTO_CALLOUT),
+        instanceData->memoryTracker->GeneralContext(),
+        m_matchLimit);
+
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::StopProfiling(const Napi::CallbackInfo &info) {
+    if (!m_profiler) {
+        return info.Env().Undefined();
+    }
+
+    Napi::Object report = m_profiler->Report(info.Env(), m_pattern);
+    m_profiler.reset();
+    AdjustExternalMemory(info.Env());
+    return report;
+}
+
+Napi::Value PCRE2::GetLastIndex(const Napi::CallbackInfo &info) {
+    return Napi::Number::New(info.Env(), m_lastIndex);
+}
+
+void PCRE2::SetLastIndex(const Napi::CallbackInfo &info, const Napi::Value &value) {
+    if (!value.IsNumber()) {
+        throw Napi::TypeError::New(info.Env(), "Expected a number");
+    }
+
+    m_lastIndex = value.As<Napi::Number>().Int64Value();
+}
+
+PCRE2::ParsedFlags PCRE2::ParseFlags(Napi::Env env, const std::string &flags) {
+    ParsedFlags parsed;
+
+    for (std::string::const_iterator i = flags.cbegin(); i != flags.cend(); i++) {
+        switch (*i) {
+            case 'd':
+                parsed.hasIndices = true;
                 break;
             case 'g':
-                m_global = true;
+                parsed.global = true;
                 break;
             case 'i':
-                m_options |= PCRE2_CASELESS;
+                parsed.options |= PCRE2_CASELESS;
                 break;
             case 'm':
-                m_options |= PCRE2_MULTILINE;
+                parsed.options |= PCRE2_MULTILINE;
                 break;
             case 's':
-                m_options |= PCRE2_DOTALL;
+                parsed.options |= PCRE2_DOTALL;
                 break;
             case 'u':
-                m_options |= PCRE2_UTF;
+                parsed.options |= PCRE2_UTF;
                 break;
             case 'v':
-                m_options |= PCRE2_ALT_EXTENDED_CLASS;
+                parsed.options |= PCRE2_ALT_EXTENDED_CLASS;
                 break;
             case 'y':
-                m_sticky = true;
+                parsed.sticky = true;
                 break;
             case 'x':
-                if (m_options | PCRE2_EXTENDED) {
-                    m_options |= PCRE2_EXTENDED_MORE;
+                if (parsed.options | PCRE2_EXTENDED) {
+                    parsed.options |= PCRE2_EXTENDED_MORE;
                 }
-                m_options |= PCRE2_EXTENDED;
+                parsed.options |= PCRE2_EXTENDED;
                 break;
             case 'n':
-               m_options |= PCRE2_NO_AUTO_CAPTURE;
+               parsed.options |= PCRE2_NO_AUTO_CAPTURE;
                break;
             case 'a':
                 if (i + 1 != flags.end()) {
                     switch (*(i + 1)) {
                     case 'D':
-                        m_extraOptions |= PCRE2_EXTRA_ASCII_BSD;
+                        parsed.extraOptions |= PCRE2_EXTRA_ASCII_BSD;
                         break;
                     case 'P':
-                        m_extraOptions |= PCRE2_EXTRA_ASCII_POSIX|PCRE2_EXTRA_ASCII_DIGIT;
+                        parsed.extraOptions |= PCRE2_EXTRA_ASCII_POSIX|PCRE2_EXTRA_ASCII_DIGIT;
                         break;
                     case 'S':
-                        m_extraOptions |= PCRE2_EXTRA_ASCII_BSS;
+                        parsed.extraOptions |= PCRE2_EXTRA_ASCII_BSS;
                         break;
                     case 'T':
-                        m_extraOptions |= PCRE2_EXTRA_ASCII_DIGIT;
+                        parsed.extraOptions |= PCRE2_EXTRA_ASCII_DIGIT;
                         break;
                     case 'W':
-                        m_extraOptions |= PCRE2_EXTRA_ASCII_BSW;
+                        parsed.extraOptions |= PCRE2_EXTRA_ASCII_BSW;
                         break;
                     default:
-                        m_extraOptions |=
+                        parsed.extraOptions |=
                             PCRE2_EXTRA_ASCII_BSD|PCRE2_EXTRA_ASCII_BSS|
                             PCRE2_EXTRA_ASCII_BSW|
                             PCRE2_EXTRA_ASCII_DIGIT|PCRE2_EXTRA_ASCII_POSIX;
                         break;
                     }
                 } else {
-                    m_extraOptions |=
+                    parsed.extraOptions |=
                         PCRE2_EXTRA_ASCII_BSD|PCRE2_EXTRA_ASCII_BSS|
                         PCRE2_EXTRA_ASCII_BSW|
                         PCRE2_EXTRA_ASCII_DIGIT|PCRE2_EXTRA_ASCII_POSIX;
                 }
                 break;
             case 'r':
-                m_extraOptions |= PCRE2_EXTRA_CASELESS_RESTRICT;
+                parsed.extraOptions |= PCRE2_EXTRA_CASELESS_RESTRICT;
                 break;
             case 'J':
-                m_options |= PCRE2_DUPNAMES;
+                parsed.options |= PCRE2_DUPNAMES;
                 break;
             case 'U':
-                m_options |= PCRE2_UNGREEDY;
+                parsed.options |= PCRE2_UNGREEDY;
                 break;
             case 'p':
-                m_pcre2 = true;
+                parsed.pcre2 = true;
                 break;
             // TODO Add flag to disable JIT or force immediate JIT?
             default:
                 throw Napi::Error::New(env, "Invalid flags supplied to PCRE2 constructor '" + flags + "'");
         }
     }
+
+    if (!parsed.pcre2) {
+        // Flags to try and behave more closely to JS RegExp
+        parsed.options |= PCRE2_ALT_BSUX | PCRE2_DOLLAR_ENDONLY | PCRE2_MATCH_UNSET_BACKREF;
+        parsed.extraOptions |= PCRE2_EXTRA_ALT_BSUX;
+    }
+
+    return parsed;
 }
 
+void PCRE2::ParseOptions(Napi::Env env, const Napi::Object &options) {
+    Napi::Value pooledMatchData = options.Get("pooledMatchData");
+    if (!pooledMatchData.IsUndefined()) {
+        m_pooledMatchData = pooledMatchData.ToBoolean();
+    }
+
+    Napi::Value heapFramesLimit = options.Get("heapFramesLimit");
+    if (!heapFramesLimit.IsUndefined()) {
+        m_heapFramesLimit = ReadCountOption(env, heapFramesLimit, "heapFramesLimit", 9007199254740991.0);
+    }
+
+    Napi::Value stats = options.Get("stats");
+    if (!stats.IsUndefined()) {
+        m_statsEnabled = stats.ToBoolean();
+    }
+
+    Napi::Value statsSampleInterval = options.Get("statsSampleInterval");
+    if (!statsSampleInterval.IsUndefined()) {
+        m_statsSampleInterval = ReadCountOption(env, statsSampleInterval, "statsSampleInterval", UINT32_MAX, 1);
+    }
+
+    Napi::Value redos = options.Get("redos");
+    if (!redos.IsUndefined()) {
+        m_redos = redos.ToString().Utf8Value();
+        if (m_redos != "reject" && m_redos != "limit") {
+            throw Napi::TypeError::New(env, "Invalid redos option '" + m_redos + "'");
+        }
+    }
+
+    Napi::Value matchLimit = options.Get("matchLimit");
+    if (!matchLimit.IsUndefined()) {
+        m_matchLimit = ReadCountOption(env, matchLimit, "matchLimit", UINT32_MAX);
+    }
+
+    Napi::Value timeoutMs = options.Get("timeoutMs");
+    if (!timeoutMs.IsUndefined()) {
+        m_timeoutMs = ReadTimeoutOption(env, timeoutMs);
+    }
+
+    Napi::Value externalStrings = options.Get("externalStrings");
+    if (!externalStrings.IsUndefined()) {
+        m_externalStrings = externalStrings.ToBoolean().Value();
+    }
+
+    Napi::Value jit = options.Get("jit");
+    if (!jit.IsUndefined()) {
+        m_jit = jit.ToBoolean();
+    }
+
+    Napi::Value matchCache = options.Get("matchCache");
+    if (!matchCache.IsUndefined()) {
+        m_matchCacheSize = ReadCountOption(env, matchCache, "matchCache", UINT32_MAX);
+    }
+
+    Napi::Value matchCacheMaxSubjectLength = options.Get("matchCacheMaxSubjectLength");
+    if (!matchCacheMaxSubjectLength.IsUndefined()) {
+        m_matchCacheMaxSubjectLength = ReadCountOption(env, matchCacheMaxSubjectLength, "matchCacheMaxSubjectLength", UINT32_MAX);
+    }
+}
 
 size_t PCRE2::AdvanceStringIndex(const std::u16string &subjectStr, size_t index) {
     if (index == subjectStr.length()) {
@@ -758,6 +1825,10 @@ size_t PCRE2::AdvanceStringIndex(const std::u16string &subjectStr, size_t index)
     return index;
 }
 
+bool PCRE2::IsPCRE2(const Napi::Value &value) {
+    return value.IsObject() && value.As<Napi::Object>().CheckTypeTag(&PCRE2TypeTag);
+}
+
 bool PCRE2::Global() const {
     return m_global;
 }
@@ -786,19 +1857,87 @@ size_t PCRE2::PatternSize(Napi::Env env) const {
     return size;
 }
 
-void PCRE2::AdjustMatchDataHeapFramesSize(Napi::Env env)
+PCRE2::MatchDataScope::MatchDataScope(PCRE2 *pcre2, Napi::Env env)
+    : m_pcre2(pcre2)
+    , m_env(env)
 {
-    size_t newSize = pcre2_get_match_data_heapframes_size(m_matchData);
-    if (newSize != m_matchDataHeapframesSize) {
-        Napi::MemoryManagement::AdjustExternalMemory(env, newSize - m_matchDataHeapframesSize);
-        m_matchDataHeapframesSize = newSize;
+    if (m_pcre2->m_matchDataDepth++ > 0 || m_pcre2->m_matchData != nullptr) {
+        return;
+    }
+
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+    if (m_pcre2->m_pooledMatchData) {
+        m_pcre2->m_matchData = instanceData->matchDataPool->Acquire(m_pcre2->m_ovectorSize);
+    } else {
+        m_pcre2->m_matchData = pcre2_match_data_create(m_pcre2->m_ovectorSize, instanceData->memoryTracker->GeneralContext());
+    }
+
+    if (m_pcre2->m_matchData == nullptr) {
+        m_pcre2->m_matchDataDepth--;
+        throw Napi::Error::New(env, "PCRE2 match data allocation failed");
     }
 }
 
+PCRE2::MatchDataScope::~MatchDataScope() {
+    if (--m_pcre2->m_matchDataDepth > 0) {
+        return;
+    }
+
+    if (m_pcre2->m_pooledMatchData) {
+        m_env.GetInstanceData<InstanceData>()->matchDataPool->Release(m_pcre2->m_matchData);
+        m_pcre2->m_matchData = nullptr;
+    } else if (m_pcre2->m_heapFramesLimit > 0 &&
+               pcre2_get_match_data_heapframes_size(m_pcre2->m_matchData) > m_pcre2->m_heapFramesLimit) {
+        // Drop the oversized heap frames, the next call creates fresh match data
+        pcre2_match_data_free(m_pcre2->m_matchData);
+        m_pcre2->m_matchData = nullptr;
+    }
+
+    m_pcre2->AdjustExternalMemory(m_env);
+}
+
+PCRE2::DeadlineScope::DeadlineScope(PCRE2 *pcre2, Napi::Env env, double timeoutMs)
+    : m_deadline(nullptr)
+{
+    if (timeoutMs <= 0) {
+        return;
+    }
+
+    MatchDeadline *deadline = pcre2->Deadline(env);
+    if (deadline->Active()) {
+        return;
+    }
+
+    m_deadline = deadline;
+    m_deadline->Start(timeoutMs);
+}
+
+PCRE2::DeadlineScope::~DeadlineScope() {
+    if (m_deadline) {
+        m_deadline->Stop();
+    }
+}
+
+PCRE2::LastIndexScope::LastIndexScope(PCRE2 *pcre2)
+    : m_pcre2(pcre2)
+    , m_lastIndex(pcre2->m_lastIndex)
+{
+}
+
+PCRE2::LastIndexScope::~LastIndexScope() {
+    m_pcre2->m_lastIndex = m_lastIndex;
+}
+
+void PCRE2::AdjustExternalMemory(Napi::Env env)
+{
+    env.GetInstanceData<InstanceData>()->AdjustExternalMemory(env);
+}
+
 void PCRE2::TierUpTick(Napi::Env env) {
     if (m_tierUpTicks > 0) {
         if (m_tierUpTicks--) {
             pcre2_jit_compile(m_re, PCRE2_JIT_COMPLETE);
+            JitPerfMap::Register(m_re, m_pattern, m_flags);
 
             size_t jitSize;
             pcre2_pattern_info(
@@ -807,14 +1946,28 @@ void PCRE2::TierUpTick(Napi::Env env) {
                 &jitSize
             );
 
-            if (jitSize != 0) {
-                m_size += jitSize;
-                Napi::MemoryManagement::AdjustExternalMemory(env, jitSize);
+            // JIT code is allocated by its own executable allocator rather
+            // than through the memory tracker
+            if (jitSize != m_jitSize) {
+                env.GetInstanceData<InstanceData>()->jitSize += jitSize - m_jitSize;
+                m_size += jitSize - m_jitSize;
+                Napi::MemoryManagement::AdjustExternalMemory(env, jitSize - m_jitSize);
+                m_jitSize = jitSize;
+            }
+
+            if (m_stats) {
+                m_stats->SetJitSize(m_jitSize);
             }
         }
     }
 }
 
+void PCRE2::EnsureJit(Napi::Env env) {
+    while (m_tierUpTicks > 0) {
+        TierUpTick(env);
+    }
+}
+
 Napi::Value PCRE2::Source(const Napi::CallbackInfo &info) {
     return Napi::String::New(info.Env(), m_pattern);
 }
@@ -907,6 +2060,347 @@ Napi::Value PCRE2::Species(const Napi::CallbackInfo &info) {
     return info.This();
 }
 
+Napi::Value PCRE2::FromShared(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    int64_t id = info[0].ToNumber().Int64Value();
+
+    SharedCode shared;
+    if (id <= 0 || !SharedCodeRegistry::Lookup(static_cast<uint64_t>(id), shared)) {
+        throw Napi::Error::New(info.Env(), "Unknown shared PCRE2 id " + std::to_string(id));
+    }
+
+    return instanceData->PCRE2.New({
+        Napi::External<SharedCode>::New(info.Env(), &shared),
+        info.Env().Undefined(),
+        info.Length() > 1 ? info[1] : info.Env().Undefined(),
+    });
+}
+
+Napi::Value PCRE2::ReleaseShared(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    int64_t id = info[0].ToNumber().Int64Value();
+    return Napi::Boolean::New(info.Env(), id > 0 && SharedCodeRegistry::Release(static_cast<uint64_t>(id)));
+}
+
+Napi::Value PCRE2::SetSlowMatchThreshold(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    double thresholdMs = 0;
+    if (info.Length() >= 1 && !info[0].IsUndefined()) {
+        thresholdMs = info[0].ToNumber().DoubleValue();
+    }
+
+    instanceData->slowMatchTracer->SetThreshold(thresholdMs);
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::SetSlowMatchPublisher(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        throw Napi::TypeError::New(info.Env(), "Expected a function");
+    }
+
+    instanceData->slowMatchTracer->SetPublisher(info[0].As<Napi::Function>());
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::SetSlowMatchSubscribed(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    instanceData->slowMatchTracer->SetSubscribed(info.Length() >= 1 && info[0].ToBoolean());
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::EnablePerfMap(const Napi::CallbackInfo &info) {
+    if (!JitPerfMap::Supported()) {
+        std::ostringstream oss;
+        oss << "Perf maps are not supported with PCRE2 " << PCRE2_MAJOR << "." << PCRE2_MINOR;
+        throw Napi::Error::New(info.Env(), oss.str());
+    }
+
+    std::string path;
+    if (info.Length() >= 1 && !info[0].IsUndefined()) {
+        path = info[0].ToString().Utf8Value();
+    }
+
+    std::string mapPath = JitPerfMap::Enable(path);
+    if (mapPath.empty()) {
+        throw Napi::Error::New(info.Env(), "Failed to open perf map " + path);
+    }
+
+    return Napi::String::New(info.Env(), mapPath);
+}
+
+Napi::Value PCRE2::DisablePerfMap(const Napi::CallbackInfo &info) {
+    JitPerfMap::Disable();
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::StartRecording(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    std::string path = info[0].ToString().Utf8Value();
+
+    uint32_t sampleInterval = 1;
+    MatchRecorder::Subjects subjects = MatchRecorder::Subjects::Length;
+    if (info.Length() > 1 && !info[1].IsUndefined()) {
+        Napi::Object options = info[1].ToObject();
+
+        Napi::Value sampleIntervalValue = options.Get("sampleInterval");
+        if (!sampleIntervalValue.IsUndefined()) {
+            sampleInterval = ReadCountOption(info.Env(), sampleIntervalValue, "sampleInterval", UINT32_MAX, 1);
+        }
+
+        Napi::Value subjectsValue = options.Get("subjects");
+        if (!subjectsValue.IsUndefined()) {
+            std::string mode = subjectsValue.ToString().Utf8Value();
+            if (mode == "length") {
+                subjects = MatchRecorder::Subjects::Length;
+            } else if (mode == "redacted") {
+                subjects = MatchRecorder::Subjects::Redacted;
+            } else if (mode == "full") {
+                subjects = MatchRecorder::Subjects::Full;
+            } else {
+                throw Napi::TypeError::New(info.Env(), "Invalid subjects option '" + mode + "'");
+            }
+        }
+    }
+
+    if (!MatchRecorder::Start(path, sampleInterval, subjects)) {
+        throw Napi::Error::New(info.Env(), "Failed to open trace " + path);
+    }
+
+    return info.Env().Undefined();
+}
+
+Napi::Value PCRE2::StopRecording(const Napi::CallbackInfo &info) {
+    bool failed;
+    int64_t records = MatchRecorder::Stop(failed);
+    if (failed) {
+        throw Napi::Error::New(info.Env(), "Failed to write the trace, it is incomplete");
+    }
+    if (records < 0) {
+        return info.Env().Undefined();
+    }
+
+    return Napi::Number::New(info.Env(), static_cast<double>(records));
+}
+
+Napi::Value PCRE2::TotalMemoryUsage(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    size_t allocated = instanceData->memoryTracker->Allocated();
+    Napi::Object result = Napi::Object::New(info.Env());
+    result["allocated"] = allocated;
+    result["jit"] = instanceData->jitSize;
+    result["total"] = allocated + instanceData->jitSize;
+    return result;
+}
+
+Napi::Value PCRE2::GetStats(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    Napi::Array result = Napi::Array::New(info.Env(), instanceData->patternStats.size());
+    uint32_t i = 0;
+    for (PatternStats *stats : instanceData->patternStats) {
+        result[i++] = stats->ToObject(info.Env());
+    }
+
+    return result;
+}
+
+Napi::Value PCRE2::Analyze(const Napi::CallbackInfo &info) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    // Constructing validates the pattern and flags just like new PCRE2 would
+    Napi::Value flags = info.Length() > 1 ? info[1] : info.Env().Undefined();
+    PCRE2 *pcre2 = PCRE2::Unwrap(instanceData->PCRE2.New({ info[0], flags }));
+
+    return PatternAnalysis(pcre2->m_pattern, pcre2->m_options).ToObject(info.Env());
+}
+
+Napi::Value PCRE2::FromGlob(const Napi::CallbackInfo &info) {
+    return FromConverted(info, PCRE2_CONVERT_GLOB);
+}
+
+Napi::Value PCRE2::FromPosix(const Napi::CallbackInfo &info) {
+    return FromConverted(info, PCRE2_CONVERT_POSIX_BASIC);
+}
+
+// Converts a glob or POSIX pattern with pcre2_pattern_convert and constructs a
+// JIT compiled instance over the result. The converted pattern is PCRE2
+// syntax, so it is always compiled in PCRE2 mode.
+Napi::Value PCRE2::FromConverted(const Napi::CallbackInfo &info, uint32_t syntax) {
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+    std::u16string pattern = info[0].ToString().Utf16Value();
+
+    Napi::Object options = Napi::Object::New(info.Env());
+    if (info.Length() >= 2 && !info[1].IsUndefined()) {
+        options = info[1].ToObject();
+    }
+
+    std::string flags;
+    Napi::Value flagsValue = options.Get("flags");
+    if (!flagsValue.IsUndefined()) {
+        flags = flagsValue.ToString().Utf8Value();
+    }
+    if (flags.find('p') == std::string::npos) {
+        flags += "p";
+    }
+
+    uint32_t convertOptions = syntax;
+    if (ParseFlags(info.Env(), flags).options & PCRE2_UTF) {
+        convertOptions |= PCRE2_CONVERT_UTF;
+    }
+
+    std::unique_ptr<pcre2_convert_context, decltype(&pcre2_convert_context_free)> convertContext(
+        pcre2_convert_context_create(instanceData->memoryTracker->GeneralContext()),
+        pcre2_convert_context_free);
+    if (!convertContext) {
+        throw Napi::Error::New(info.Env(), "PCRE2 convert context allocation failed");
+    }
+
+    if (syntax == PCRE2_CONVERT_GLOB) {
+        Napi::Value separator = options.Get("separator");
+        if (!separator.IsUndefined()) {
+            std::u16string separatorStr = separator.ToString().Utf16Value();
+            if (separatorStr.size() != 1 || pcre2_set_glob_separator(convertContext.get(), separatorStr[0]) != 0) {
+                throw Napi::TypeError::New(info.Env(), "Invalid glob separator");
+            }
+        }
+
+        // null or an empty string disables escaping
+        Napi::Value escape = options.Get("escape");
+        if (!escape.IsUndefined()) {
+            std::u16string escapeStr = escape.IsNull() ? std::u16string() : escape.ToString().Utf16Value();
+            if (escapeStr.size() > 1 ||
+                pcre2_set_glob_escape(convertContext.get(), escapeStr.empty() ? 0 : escapeStr[0]) != 0)
+            {
+                throw Napi::TypeError::New(info.Env(), "Invalid glob escape");
+            }
+        }
+
+        // Despite its name, PCRE2_CONVERT_GLOB_NO_WILD_SEPARATOR lets
+        // wildcards match the separator
+        if (options.Get("wildSeparator").ToBoolean()) {
+            convertOptions |= PCRE2_CONVERT_GLOB_NO_WILD_SEPARATOR;
+        }
+
+        Napi::Value starStar = options.Get("starStar");
+        if (!starStar.IsUndefined() && !starStar.ToBoolean()) {
+            convertOptions |= PCRE2_CONVERT_GLOB_NO_STARSTAR;
+        }
+    } else if (options.Get("extended").ToBoolean()) {
+        convertOptions = (convertOptions & ~PCRE2_CONVERT_POSIX_BASIC) | PCRE2_CONVERT_POSIX_EXTENDED;
+    }
+
+    PCRE2_UCHAR *converted = nullptr;
+    PCRE2_SIZE convertedLength;
+    int rc = pcre2_pattern_convert(
+        reinterpret_cast<PCRE2_SPTR>(pattern.c_str()),
+        pattern.size(),
+        convertOptions,
+        &converted,
+        &convertedLength,
+        convertContext.get()
+    );
+    if (rc != 0) {
+        PCRE2_UCHAR errorBuffer[256];
+        pcre2_get_error_message(rc, errorBuffer, sizeof(errorBuffer));
+        std::ostringstream oss;
+        oss << "PCRE2 pattern conversion failed at offset " << convertedLength << ": ";
+        // Error messages are plain ASCII
+        for (PCRE2_UCHAR *p = errorBuffer; *p != 0; p++) {
+            oss << static_cast<char>(*p);
+        }
+        throw Napi::Error::New(info.Env(), oss.str());
+    }
+
+    Napi::String source = Napi::String::New(
+        info.Env(), reinterpret_cast<const char16_t*>(converted), convertedLength);
+    pcre2_converted_pattern_free(converted);
+
+    Napi::Object result = instanceData->PCRE2.New({ source, Napi::String::New(info.Env(), flags), options });
+    PCRE2::Unwrap(result)->EnsureJit(info.Env());
+    return result;
+}
+
+Napi::Value PCRE2::CompileMany(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    if (!info[0].IsArray()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of patterns");
+    }
+    Napi::Array patterns = info[0].As<Napi::Array>();
+
+    size_t threads = std::thread::hardware_concurrency();
+    if (info.Length() >= 2 && !info[1].IsUndefined()) {
+        Napi::Value threadsValue = info[1].ToObject().Get("threads");
+        if (!threadsValue.IsUndefined()) {
+            threads = ReadCountOption(info.Env(), threadsValue, "threads", UINT32_MAX, 1);
+        }
+    }
+
+    std::shared_ptr<PCRE2CompileJob> job = std::make_shared<PCRE2CompileJob>(info.Env());
+
+    uint32_t length = patterns.Length();
+    job->entries.resize(length);
+    for (uint32_t i = 0; i < length; i++) {
+        PCRE2CompileJob::Entry &entry = job->entries[i];
+
+        // Either a pattern string or { pattern, flags, options }
+        Napi::Value value = patterns.Get(i);
+        if (value.IsObject()) {
+            Napi::Object object = value.As<Napi::Object>();
+            entry.pattern = object.Get("pattern").ToString().Utf16Value();
+
+            Napi::Value flags = object.Get("flags");
+            if (!flags.IsUndefined()) {
+                entry.flags = flags.ToString().Utf8Value();
+            }
+
+            Napi::Value options = object.Get("options");
+            if (options.IsObject()) {
+                entry.constructorOptions = Napi::Persistent(options.As<Napi::Object>());
+            }
+        } else {
+            entry.pattern = value.ToString().Utf16Value();
+        }
+
+        // Invalid flags only fail their own entry
+        try {
+            ParsedFlags parsed = ParseFlags(info.Env(), entry.flags);
+            entry.options = parsed.options;
+            entry.extraOptions = parsed.extraOptions;
+        } catch (const Napi::Error &error) {
+            entry.error = error.Message();
+        }
+    }
+
+    return PCRE2CompileWorker::Start(info.Env(), job, threads);
+}
+
 Napi::Function PCRE2::SpeciesConstructor(Napi::Env env, const Napi::Object &obj, const Napi::Function &defaultConstructor) {
     Napi::EscapableHandleScope scope(env);
 
@@ -1,17 +1,65 @@
 #ifndef NODE_PCRE2_PCRE2_H_
 #define NODE_PCRE2_PCRE2_H_
 
+#include <memory>
+#include <string>
+#include <vector>
 #include <napi.h>
 #include <pcre2.h>
+#include "LiteralSearcher.h"
+#include "MatchCache.h"
+#include "MatchDeadline.h"
+#include "PatternProfiler.h"
+#include "PatternStats.h"
 
 class PCRE2 : public Napi::ObjectWrap<PCRE2> {
 public:
+    // What a flags string translates to
+    struct ParsedFlags {
+        uint32_t options = 0;
+        uint32_t extraOptions = 0;
+        bool global = false;
+        bool sticky = false;
+        bool hasIndices = false;
+        bool pcre2 = false;
+    };
+
+    // Where a global scan over a subject is at, see ScanNext
+    struct ScanState {
+        size_t cursor = 0;
+        // Retrying at the cursor after an empty match, in PCRE2 mode
+        bool notEmpty = false;
+        bool done = false;
+
+        bool operator==(const ScanState &other) const {
+            return cursor == other.cursor && notEmpty == other.notEmpty && done == other.done;
+        }
+    };
+
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
     explicit PCRE2(const Napi::CallbackInfo &info);
     virtual ~PCRE2();
 
     Napi::Value ExecImpl(Napi::Env env, const Napi::String &subject, uint32_t options = 0);
+    // Same as above, reusing an already converted subject
+    Napi::Value ExecImpl(
+        Napi::Env env,
+        const Napi::String &subject,
+        const std::shared_ptr<const std::u16string> &subjectBuffer,
+        uint32_t options = 0);
+    bool TestSubject(Napi::Env env, const std::u16string &subject);
+    bool ScanNext(Napi::Env env, const std::u16string &subject, ScanState &state, size_t &start, size_t &end);
+    bool MatchToken(Napi::Env env, const std::u16string &subject, size_t start, size_t &end, PCRE2_SPTR &mark);
+    std::vector<std::u16string> FilterLiterals() const;
+    // The number and name of each named group, from the name table
+    std::vector<std::pair<uint32_t, std::u16string>> GroupNames() const;
+    size_t MaxLookbehind() const;
+    size_t MaxReach() const;
     size_t AdvanceStringIndex(const std::u16string &subjectStr, size_t index);
+    static ParsedFlags ParseFlags(Napi::Env env, const std::string &flags);
+    static std::string CompileErrorMessage(int errorCode, size_t errorOffset);
+    static bool IsPCRE2(const Napi::Value &value);
+
     bool Global() const;
     bool PCRE2Mode() const;
     size_t LastIndex() const;
@@ -21,6 +69,52 @@ public:
     PCRE2& operator=(const PCRE2&) = delete;
 
 private:
+    // Makes m_matchData available for the duration of a call, borrowing it
+    // from the pool when match data is pooled, and applying the heap frames
+    // limit when done.
+    class MatchDataScope {
+    public:
+        MatchDataScope(PCRE2 *pcre2, Napi::Env env);
+        ~MatchDataScope();
+
+        MatchDataScope(const MatchDataScope&) = delete;
+        MatchDataScope& operator=(const MatchDataScope&) = delete;
+
+    private:
+        PCRE2 *m_pcre2;
+        Napi::Env m_env;
+    };
+
+    // Starts a deadline for the duration of a call when it has a timeout.
+    // Calls nested in one with a deadline, such as from a replacer function,
+    // share the outer deadline.
+    class DeadlineScope {
+    public:
+        DeadlineScope(PCRE2 *pcre2, Napi::Env env, double timeoutMs);
+        ~DeadlineScope();
+
+        DeadlineScope(const DeadlineScope&) = delete;
+        DeadlineScope& operator=(const DeadlineScope&) = delete;
+
+    private:
+        MatchDeadline *m_deadline;
+    };
+
+    // Restores lastIndex when a call that matches from another position
+    // returns or throws
+    class LastIndexScope {
+    public:
+        explicit LastIndexScope(PCRE2 *pcre2);
+        ~LastIndexScope();
+
+        LastIndexScope(const LastIndexScope&) = delete;
+        LastIndexScope& operator=(const LastIndexScope&) = delete;
+
+    private:
+        PCRE2 *m_pcre2;
+        size_t m_lastIndex;
+    };
+
     Napi::Value Exec(const Napi::CallbackInfo &info);
     Napi::Value Test(const Napi::CallbackInfo &info);
     Napi::Value ToString(const Napi::CallbackInfo &info);
@@ -29,6 +123,15 @@ private:
     Napi::Value Split(const Napi::CallbackInfo &info);
     Napi::Value MatchAll(const Napi::CallbackInfo &info);
     Napi::Value Replace(const Napi::CallbackInfo &info);
+    Napi::Value FilterParallel(const Napi::CallbackInfo &info);
+    Napi::Value FilterPaths(const Napi::CallbackInfo &info);
+    Napi::Value ExtractColumns(const Napi::CallbackInfo &info);
+    Napi::Value Share(const Napi::CallbackInfo &info);
+    Napi::Value MemoryUsage(const Napi::CallbackInfo &info);
+    Napi::Value Stats(const Napi::CallbackInfo &info);
+    Napi::Value MatchCacheStats(const Napi::CallbackInfo &info);
+    Napi::Value StartProfiling(const Napi::CallbackInfo &info);
+    Napi::Value StopProfiling(const Napi::CallbackInfo &info);
     Napi::Value GetLastIndex(const Napi::CallbackInfo &info);
     void SetLastIndex(const Napi::CallbackInfo &info, const Napi::Value &value);
     Napi::Value Source(const Napi::CallbackInfo &info);
@@ -55,13 +158,59 @@ private:
     Napi::Value PCRE2Mode(const Napi::CallbackInfo &info);
 
     static Napi::Value Species(const Napi::CallbackInfo &info);
+    static Napi::Value FromShared(const Napi::CallbackInfo &info);
+    static Napi::Value ReleaseShared(const Napi::CallbackInfo &info);
+    static Napi::Value TotalMemoryUsage(const Napi::CallbackInfo &info);
+    static Napi::Value GetStats(const Napi::CallbackInfo &info);
+    static Napi::Value Analyze(const Napi::CallbackInfo &info);
+    static Napi::Value CompileMany(const Napi::CallbackInfo &info);
+    static Napi::Value FromGlob(const Napi::CallbackInfo &info);
+    static Napi::Value FromPosix(const Napi::CallbackInfo &info);
+    static Napi::Value FromConverted(const Napi::CallbackInfo &info, uint32_t syntax);
+    static Napi::Value SetSlowMatchThreshold(const Napi::CallbackInfo &info);
+    // Exported for the JS wrapper rather than as a static method of PCRE2
+    static Napi::Value SetSlowMatchPublisher(const Napi::CallbackInfo &info);
+    static Napi::Value SetSlowMatchSubscribed(const Napi::CallbackInfo &info);
+    static Napi::Value EnablePerfMap(const Napi::CallbackInfo &info);
+    static Napi::Value DisablePerfMap(const Napi::CallbackInfo &info);
+    static Napi::Value StartRecording(const Napi::CallbackInfo &info);
+    static Napi::Value StopRecording(const Napi::CallbackInfo &info);
     static Napi::Function SpeciesConstructor(Napi::Env env, const Napi::Object &obj, const Napi::Function &defaultConstructor);
 
-    void ParseFlags(Napi::Env env, const std::string &flags);
+    void ParseOptions(Napi::Env env, const Napi::Object &options);
+    pcre2_code *Compile(Napi::Env env, uint32_t extraOptions = 0) const;
     size_t PatternSize(Napi::Env env) const;
-    void AdjustMatchDataHeapFramesSize(Napi::Env env);
+    void AdjustExternalMemory(Napi::Env env);
+
+    int MatchImpl(Napi::Env env, const std::u16string &subject, size_t startOffset, uint32_t options);
+    int SubstituteImpl(
+        Napi::Env env,
+        const std::u16string &subject,
+        const std::u16string &replacement,
+        size_t startOffset,
+        uint32_t options,
+        std::vector<PCRE2_UCHAR> &outputBuffer,
+        PCRE2_SIZE &outputLength);
+    int LiteralMatch(const std::u16string &subject, size_t startOffset, uint32_t options);
+    int LiteralSubstitute(
+        const std::u16string &subject,
+        const std::u16string &replacement,
+        uint32_t options,
+        std::vector<PCRE2_UCHAR> &outputBuffer,
+        PCRE2_SIZE &outputLength);
+
+    Napi::String Substring(
+        Napi::Env env,
+        const std::shared_ptr<const std::u16string> &subjectBuffer,
+        size_t start,
+        size_t length) const;
+    double CallTimeout(const Napi::CallbackInfo &info, size_t index) const;
+    MatchDeadline *Deadline(Napi::Env env);
+    void ThrowIfTimedOut(Napi::Env env, int rc) const;
+    static void ThrowMatchError(Napi::Env env, int rc);
 
     void TierUpTick(Napi::Env env);
+    void EnsureJit(Napi::Env env);
 
     std::u16string m_pattern;
     std::string m_flags;
@@ -71,14 +220,34 @@ private:
     bool m_sticky;
     bool m_hasIndices;
     bool m_pcre2;
+    std::shared_ptr<pcre2_code> m_code;
     pcre2_code *m_re;
     pcre2_match_data *m_matchData;
+    uint32_t m_ovectorSize;
+    bool m_pooledMatchData;
+    size_t m_heapFramesLimit;
+    int m_matchDataDepth;
+    bool m_statsEnabled;
+    uint32_t m_statsSampleInterval;
+    std::shared_ptr<PatternStats> m_stats;
+    std::string m_redos;
+    uint32_t m_matchLimit;
+    pcre2_match_context *m_matchContext;
+    double m_timeoutMs;
+    bool m_externalStrings;
+    bool m_jit;
+    size_t m_matchCacheSize;
+    size_t m_matchCacheMaxSubjectLength;
+    std::shared_ptr<MatchCache> m_matchCache;
+    std::shared_ptr<MatchDeadline> m_deadline;
+    std::shared_ptr<PatternProfiler> m_profiler;
+    std::unique_ptr<LiteralSearcher> m_literal;
     size_t m_lastIndex;
     int m_tierUpTicks;
     bool m_utf8;
     bool m_crlfIsNewline;
     size_t m_size;
-    size_t m_matchDataHeapframesSize;
+    size_t m_jitSize;
 };
 
 #endif // NODE_PCRE2_PCRE2_H_
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include "InstanceData.h"
+#include "JitPerfMap.h"
+#include "PCRE2.h"
+#include "PCRE2CompileWorker.h"
+#include "SharedCodeRegistry.h"
+
+PCRE2CompileJob::PCRE2CompileJob(Napi::Env env)
+    : deferred(Napi::Promise::Deferred::New(env))
+    , pending(0)
+{
+}
+
+Napi::Value PCRE2CompileWorker::Start(Napi::Env env, std::shared_ptr<PCRE2CompileJob> job, size_t threads) {
+    size_t count = job->entries.size();
+
+    if (count == 0) {
+        job->deferred.Resolve(Napi::Array::New(env, 0));
+        return job->deferred.Promise();
+    }
+
+    // Workers take every threads-th entry rather than a contiguous chunk, so
+    // that a run of expensive patterns is spread between them
+    threads = std::max<size_t>(std::min(threads, count), 1);
+    for (size_t i = 0; i < threads; i++) {
+        job->pending++;
+        (new PCRE2CompileWorker(env, job, i, threads))->Queue();
+    }
+
+    return job->deferred.Promise();
+}
+
+PCRE2CompileWorker::PCRE2CompileWorker(Napi::Env env, std::shared_ptr<PCRE2CompileJob> job, size_t first, size_t step)
+    : Napi::AsyncWorker(env, "PCRE2CompileWorker")
+    , m_job(std::move(job))
+    , m_first(first)
+    , m_step(step)
+{
+    m_compileContext = pcre2_compile_context_copy(env.GetInstanceData<InstanceData>()->compileContext);
+}
+
+PCRE2CompileWorker::~PCRE2CompileWorker() {
+    pcre2_compile_context_free(m_compileContext);
+}
+
+void PCRE2CompileWorker::Execute() {
+    if (m_compileContext == nullptr) {
+        SetError("PCRE2 compile context allocation failed");
+        return;
+    }
+
+    for (size_t i = m_first; i < m_job->entries.size(); i += m_step) {
+        PCRE2CompileJob::Entry &entry = m_job->entries[i];
+        if (!entry.error.empty()) {
+            continue;
+        }
+
+        pcre2_set_compile_extra_options(m_compileContext, entry.extraOptions);
+
+        PCRE2_SIZE errorOffset;
+        pcre2_code *code = pcre2_compile(
+            reinterpret_cast<PCRE2_SPTR>(entry.pattern.c_str()),
+            entry.pattern.size(),
+            entry.options,
+            &entry.errorCode,
+            &errorOffset,
+            m_compileContext
+        );
+        if (code == nullptr) {
+            entry.errorOffset = errorOffset;
+            continue;
+        }
+
+        pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+        entry.code = std::shared_ptr<pcre2_code>(code, JitPerfMap::Free);
+    }
+}
+
+void PCRE2CompileWorker::OnOK() {
+    Done();
+}
+
+void PCRE2CompileWorker::OnError(const Napi::Error &error) {
+    if (m_job->error.empty()) {
+        m_job->error = error.Message();
+    }
+
+    Done();
+}
+
+void PCRE2CompileWorker::Done() {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+
+    if (--m_job->pending > 0) {
+        return;
+    }
+
+    if (!m_job->error.empty()) {
+        m_job->deferred.Reject(Napi::Error::New(env, m_job->error).Value());
+        return;
+    }
+
+    Napi::Array result = Napi::Array::New(env, m_job->entries.size());
+    for (size_t i = 0; i < m_job->entries.size(); i++) {
+        PCRE2CompileJob::Entry &entry = m_job->entries[i];
+
+        if (!entry.code) {
+            if (!entry.error.empty()) {
+                result[i] = Napi::Error::New(env, entry.error).Value();
+            } else {
+                Napi::Error error = Napi::Error::New(env, PCRE2::CompileErrorMessage(entry.errorCode, entry.errorOffset));
+                error.Set("offset", Napi::Number::New(env, static_cast<double>(entry.errorOffset)));
+                result[i] = error.Value();
+            }
+            continue;
+        }
+
+        // Constructed over the compiled code the same way as fromShared does,
+        // so the options may still fail construction, e.g. redos: "reject"
+        SharedCode shared = { entry.code, entry.pattern, entry.flags };
+        try {
+            result[i] = instanceData->PCRE2.New({
+                Napi::External<SharedCode>::New(env, &shared),
+                env.Undefined(),
+                entry.constructorOptions.IsEmpty() ? env.Undefined() : entry.constructorOptions.Value(),
+            });
+        } catch (const Napi::Error &error) {
+            result[i] = error.Value();
+        }
+    }
+
+    m_job->deferred.Resolve(result);
+}
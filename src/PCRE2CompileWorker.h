@@ -0,0 +1,61 @@
+#ifndef NODE_PCRE2_COMPILE_WORKER_H_
+#define NODE_PCRE2_COMPILE_WORKER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <napi.h>
+#include <pcre2.h>
+
+// State shared by all the workers of a single compileMany call. Only touched
+// from the main thread, except for the entries owned by each worker while it
+// executes.
+struct PCRE2CompileJob {
+    struct Entry {
+        std::u16string pattern;
+        std::string flags;
+        uint32_t options = 0;
+        uint32_t extraOptions = 0;
+        // The options passed to the constructor once compiled
+        Napi::ObjectReference constructorOptions;
+        std::shared_ptr<pcre2_code> code;
+        // Set for invalid flags, before compilation
+        std::string error;
+        int errorCode = 0;
+        size_t errorOffset = 0;
+    };
+
+    explicit PCRE2CompileJob(Napi::Env env);
+
+    Napi::Promise::Deferred deferred;
+    std::vector<Entry> entries;
+    size_t pending;
+    std::string error;
+};
+
+class PCRE2CompileWorker : public Napi::AsyncWorker {
+public:
+    PCRE2CompileWorker(Napi::Env env, std::shared_ptr<PCRE2CompileJob> job, size_t first, size_t step);
+    virtual ~PCRE2CompileWorker();
+
+    PCRE2CompileWorker(const PCRE2CompileWorker&) = delete;
+    PCRE2CompileWorker& operator=(const PCRE2CompileWorker&) = delete;
+
+    static Napi::Value Start(Napi::Env env, std::shared_ptr<PCRE2CompileJob> job, size_t threads);
+
+protected:
+    void Execute() override;
+    void OnOK() override;
+    void OnError(const Napi::Error &error) override;
+
+private:
+    void Done();
+
+    std::shared_ptr<PCRE2CompileJob> m_job;
+    size_t m_first;
+    size_t m_step;
+    // A private copy, as compile contexts are modified per pattern
+    pcre2_compile_context *m_compileContext;
+};
+
+#endif // NODE_PCRE2_COMPILE_WORKER_H_
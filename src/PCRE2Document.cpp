@@ -0,0 +1,200 @@
+#include <algorithm>
+#include "InstanceData.h"
+#include "PCRE2Document.h"
+
+namespace {
+    // Assertions such as \b, ^ and $ look at the character, or CRLF, next to
+    // where they are, which neither the lookbehind nor the reach count
+    const size_t kAssertionSlack = 2;
+}
+
+Napi::Object PCRE2Document::Init(Napi::Env env, Napi::Object exports) {
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+
+    Napi::Function func = DefineClass(env, "PCRE2Document", {
+        InstanceMethod<&PCRE2Document::Edit>("edit"),
+        InstanceAccessor<&PCRE2Document::Text>("text"),
+        InstanceAccessor<&PCRE2Document::Matches>("matches"),
+    });
+
+    instanceData->PCRE2Document = Napi::Persistent(func);
+    exports.Set("PCRE2Document", func);
+
+    return exports;
+}
+
+PCRE2Document::PCRE2Document(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<PCRE2Document>(info)
+{
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 2) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    // Anything else is compiled like new PCRE2 would
+    Napi::Value pattern = info[0];
+    if (!PCRE2::IsPCRE2(pattern)) {
+        pattern = instanceData->PCRE2.New({ pattern });
+    }
+    m_pcre2Ref = Napi::Persistent(pattern.As<Napi::Object>());
+    m_pcre2 = PCRE2::Unwrap(m_pcre2Ref.Value());
+
+    m_text = info[1].ToString().Utf16Value();
+    m_lookbehind = m_pcre2->MaxLookbehind() + kAssertionSlack;
+    m_reach = m_pcre2->MaxReach();
+    if (m_reach != SIZE_MAX) {
+        m_reach += kAssertionSlack;
+    }
+
+    PCRE2::ScanState state;
+    Match match;
+    m_states.push_back(state);
+    while (m_pcre2->ScanNext(info.Env(), m_text, state, match.start, match.end)) {
+        m_matches.push_back(match);
+        m_states.push_back(state);
+    }
+}
+
+PCRE2Document::~PCRE2Document() {}
+
+Napi::Value PCRE2Document::Edit(const Napi::CallbackInfo &info) {
+    if (info.Length() < 2) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    // Clamped like splice
+    int64_t offsetValue = info[0].ToNumber().Int64Value();
+    size_t offset = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(offsetValue, 0), m_text.size()));
+    int64_t deleteValue = info[1].ToNumber().Int64Value();
+    size_t deleteCount = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(deleteValue, 0), m_text.size() - offset));
+    std::u16string insert;
+    if (info.Length() > 2 && !info[2].IsUndefined()) {
+        insert = info[2].ToString().Utf16Value();
+    }
+
+    size_t newEnd = offset + insert.size();
+    auto shift = [&](size_t position) {
+        return position - deleteCount + insert.size();
+    };
+
+    // Attempts that found a match early enough to not have looked at the
+    // edit would find the same match. Without a bound on how far the pattern
+    // looks, everything is rescanned.
+    size_t first = 0;
+    if (m_reach != SIZE_MAX) {
+        first = std::partition_point(m_matches.begin(), m_matches.end(), [&](const Match &match) {
+            return match.start + m_reach <= offset;
+        }) - m_matches.begin();
+    }
+    // Stepping over an empty match looks at the text up to the next cursor
+    while (first > 0 && m_states[first].cursor >= offset) {
+        first--;
+    }
+
+    std::u16string deleted = m_text.substr(offset, deleteCount);
+    m_text.replace(offset, deleteCount, insert);
+
+    // Scan until the scan is at the same state as the old one was, far
+    // enough past the edit that nothing after can have looked at it
+    std::vector<Match> added;
+    std::vector<PCRE2::ScanState> addedStates;
+    size_t resume = m_matches.size();
+    bool inStep = false;
+    try {
+        PCRE2::ScanState state = m_states[first];
+        size_t next = first;
+        Match match;
+        while (m_pcre2->ScanNext(info.Env(), m_text, state, match.start, match.end)) {
+            added.push_back(match);
+            addedStates.push_back(state);
+
+            if (state.cursor < newEnd + m_lookbehind) {
+                continue;
+            }
+
+            PCRE2::ScanState old = state;
+            old.cursor = state.cursor + deleteCount - insert.size();
+            while (next < m_states.size() && m_states[next].cursor < old.cursor) {
+                next++;
+            }
+            for (size_t j = next; j < m_states.size() && m_states[j].cursor == old.cursor; j++) {
+                if (m_states[j] == old) {
+                    resume = j;
+                    inStep = true;
+                    break;
+                }
+            }
+            if (inStep) {
+                break;
+            }
+        }
+    } catch (...) {
+        m_text.replace(offset, insert.size(), deleted);
+        throw;
+    }
+
+    // The rescan usually finds some of the same matches again at either end
+    size_t prefix = 0;
+    while (prefix < added.size() && first + prefix < resume &&
+        m_matches[first + prefix].start == added[prefix].start &&
+        m_matches[first + prefix].end == added[prefix].end &&
+        added[prefix].end <= offset)
+    {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < added.size() - prefix && first + prefix + suffix < resume) {
+        const Match &old = m_matches[resume - suffix - 1];
+        const Match &match = added[added.size() - suffix - 1];
+        if (old.start < offset + deleteCount || shift(old.start) != match.start || shift(old.end) != match.end) {
+            break;
+        }
+        suffix++;
+    }
+
+    Napi::Object result = Napi::Object::New(info.Env());
+    result["index"] = static_cast<double>(first + prefix);
+    result["removed"] = ToArray(info.Env(), m_matches, first + prefix, resume - suffix);
+    result["added"] = ToArray(info.Env(), added, prefix, added.size() - suffix);
+
+    // Splice in the new matches, and the states before them. When back in
+    // step, the state after the last added match is the old one at resume.
+    std::vector<Match> matches(m_matches.begin(), m_matches.begin() + first);
+    matches.insert(matches.end(), added.begin(), added.end());
+    std::vector<PCRE2::ScanState> states(m_states.begin(), m_states.begin() + first + 1);
+    states.insert(states.end(), addedStates.begin(), addedStates.end() - (inStep ? 1 : 0));
+    if (inStep) {
+        for (size_t j = resume; j < m_matches.size(); j++) {
+            matches.push_back({ shift(m_matches[j].start), shift(m_matches[j].end) });
+        }
+        for (size_t j = resume; j < m_states.size(); j++) {
+            PCRE2::ScanState state = m_states[j];
+            state.cursor = shift(state.cursor);
+            states.push_back(state);
+        }
+    }
+    m_matches = std::move(matches);
+    m_states = std::move(states);
+
+    return result;
+}
+
+Napi::Value PCRE2Document::Text(const Napi::CallbackInfo &info) {
+    return Napi::String::New(info.Env(), m_text);
+}
+
+Napi::Value PCRE2Document::Matches(const Napi::CallbackInfo &info) {
+    return ToArray(info.Env(), m_matches, 0, m_matches.size());
+}
+
+Napi::Array PCRE2Document::ToArray(Napi::Env env, const std::vector<Match> &matches, size_t begin, size_t end) {
+    Napi::Array result = Napi::Array::New(env, end - begin);
+    for (size_t i = begin; i < end; i++) {
+        Napi::Object item = Napi::Object::New(env);
+        item["start"] = static_cast<double>(matches[i].start);
+        item["end"] = static_cast<double>(matches[i].end);
+        result[static_cast<uint32_t>(i - begin)] = item;
+    }
+    return result;
+}
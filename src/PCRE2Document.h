@@ -0,0 +1,45 @@
+#ifndef NODE_PCRE2_DOCUMENT_H_
+#define NODE_PCRE2_DOCUMENT_H_
+
+#include <string>
+#include <vector>
+#include <napi.h>
+#include "PCRE2.h"
+
+// A subject and the matches of a global scan over it, kept up to date as the
+// subject is edited. An edit only rescans from the first match whose attempt
+// may have looked at the edited text, until the scan is back in step with the
+// old one past the edit.
+class PCRE2Document : public Napi::ObjectWrap<PCRE2Document> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    explicit PCRE2Document(const Napi::CallbackInfo &info);
+    virtual ~PCRE2Document();
+
+    PCRE2Document(const PCRE2Document&) = delete;
+    PCRE2Document& operator=(const PCRE2Document&) = delete;
+
+private:
+    struct Match {
+        size_t start;
+        size_t end;
+    };
+
+    Napi::Value Edit(const Napi::CallbackInfo &info);
+    Napi::Value Text(const Napi::CallbackInfo &info);
+    Napi::Value Matches(const Napi::CallbackInfo &info);
+
+    static Napi::Array ToArray(Napi::Env env, const std::vector<Match> &matches, size_t begin, size_t end);
+
+    Napi::ObjectReference m_pcre2Ref;
+    PCRE2 *m_pcre2;
+    std::u16string m_text;
+    std::vector<Match> m_matches;
+    // The state of the scan before each match, and before the attempt that
+    // ended it
+    std::vector<PCRE2::ScanState> m_states;
+    size_t m_lookbehind;
+    size_t m_reach;
+};
+
+#endif // NODE_PCRE2_DOCUMENT_H_
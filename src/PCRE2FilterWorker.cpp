@@ -0,0 +1,181 @@
+#include <sstream>
+#include "PCRE2FilterWorker.h"
+
+PCRE2FilterJob::PCRE2FilterJob(Napi::Env env, const Napi::Object &pcre2, pcre2_code *re, uint32_t options)
+    : deferred(Napi::Promise::Deferred::New(env))
+    , pcre2Ref(Napi::Persistent(pcre2))
+    , re(re)
+    , options(options)
+    , matchLimit(0)
+    , pending(0)
+    , abortable(false)
+    , aborted(false)
+{
+}
+
+Napi::Value PCRE2FilterWorker::Start(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, size_t threads) {
+    size_t count = job->subjects.size();
+    job->matched.resize(count);
+
+    if (count == 0) {
+        job->deferred.Resolve(Napi::Uint32Array::New(env, 0));
+        return job->deferred.Promise();
+    }
+
+    threads = std::max<size_t>(std::min(threads, count), 1);
+    size_t chunkSize = count / threads;
+    size_t remainder = count % threads;
+
+    size_t begin = 0;
+    for (size_t i = 0; i < threads; i++) {
+        size_t end = begin + chunkSize + (i < remainder ? 1 : 0);
+        job->pending++;
+        (new PCRE2FilterWorker(env, job, begin, end))->Queue();
+        begin = end;
+    }
+
+    return job->deferred.Promise();
+}
+
+void PCRE2FilterWorker::WatchSignal(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, const Napi::Object &signal) {
+    // The listener must not keep the job alive, the signal may outlive it
+    std::weak_ptr<PCRE2FilterJob> weakJob = job;
+    Napi::Function listener = Napi::Function::New(env, [weakJob](const Napi::CallbackInfo &info) {
+        if (std::shared_ptr<PCRE2FilterJob> job = weakJob.lock()) {
+            job->aborted = true;
+        }
+    });
+
+    signal.Get("addEventListener").As<Napi::Function>().Call(signal, { Napi::String::New(env, "abort"), listener });
+
+    job->abortable = true;
+    job->signalRef = Napi::Persistent(signal);
+    job->abortListenerRef = Napi::Persistent(listener);
+}
+
+PCRE2FilterWorker::PCRE2FilterWorker(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, size_t begin, size_t end)
+    : Napi::AsyncWorker(env, "PCRE2FilterWorker")
+    , m_job(std::move(job))
+    , m_begin(begin)
+    , m_end(end)
+{
+}
+
+PCRE2FilterWorker::~PCRE2FilterWorker() {}
+
+void PCRE2FilterWorker::Execute() {
+    pcre2_match_data *matchData = pcre2_match_data_create_from_pattern(m_job->re, nullptr);
+    pcre2_match_context *matchContext = pcre2_match_context_create(nullptr);
+    pcre2_jit_stack *jitStack = pcre2_jit_stack_create(32 * 1024, 1024 * 1024, nullptr);
+
+    if (matchData == nullptr || matchContext == nullptr || jitStack == nullptr) {
+        SetError("PCRE2 match data allocation failed");
+    } else {
+        pcre2_jit_stack_assign(matchContext, nullptr, jitStack);
+        if (m_job->matchLimit != 0) {
+            pcre2_set_match_limit(matchContext, m_job->matchLimit);
+        }
+        if (m_job->abortable) {
+            pcre2_set_callout(matchContext, AbortCallout, m_job.get());
+        }
+
+        for (size_t i = m_begin; i < m_end; i++) {
+            if (m_job->aborted) {
+                break;
+            }
+
+            const std::u16string &subject = m_job->subjects[i];
+            int rc = pcre2_match(
+                m_job->re,
+                reinterpret_cast<PCRE2_SPTR>(subject.c_str()),
+                subject.length(),
+                0,
+                m_job->options,
+                matchData,
+                matchContext
+            );
+            if (rc < 0) {
+                if (rc == PCRE2_ERROR_NOMATCH) {
+                    continue;
+                }
+                if (rc == PCRE2_ERROR_CALLOUT && m_job->aborted) {
+                    break;
+                }
+
+                PCRE2_UCHAR errorBuffer[256];
+                pcre2_get_error_message(rc, errorBuffer, sizeof(errorBuffer));
+                std::ostringstream oss;
+                oss << "PCRE2 matching error " << rc << ": ";
+                // Error messages are plain ASCII
+                for (PCRE2_UCHAR *p = errorBuffer; *p != 0; p++) {
+                    oss << static_cast<char>(*p);
+                }
+                SetError(oss.str());
+                break;
+            }
+
+            m_job->matched[i] = 1;
+        }
+    }
+
+    pcre2_jit_stack_free(jitStack);
+    pcre2_match_context_free(matchContext);
+    pcre2_match_data_free(matchData);
+}
+
+int PCRE2FilterWorker::AbortCallout(pcre2_callout_block *block, void *data) {
+    PCRE2FilterJob *job = static_cast<PCRE2FilterJob*>(data);
+    return job->aborted.load(std::memory_order_relaxed) ? PCRE2_ERROR_CALLOUT : 0;
+}
+
+void PCRE2FilterWorker::OnOK() {
+    Done();
+}
+
+void PCRE2FilterWorker::OnError(const Napi::Error &error) {
+    if (m_job->error.empty()) {
+        m_job->error = error.Message();
+    }
+
+    Done();
+}
+
+void PCRE2FilterWorker::Done() {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+
+    if (--m_job->pending > 0) {
+        return;
+    }
+
+    if (!m_job->signalRef.IsEmpty()) {
+        Napi::Object signal = m_job->signalRef.Value();
+        signal.Get("removeEventListener").As<Napi::Function>().Call(
+            signal, { Napi::String::New(env, "abort"), m_job->abortListenerRef.Value() });
+
+        if (m_job->aborted) {
+            m_job->deferred.Reject(signal.Get("reason"));
+            return;
+        }
+    }
+
+    if (!m_job->error.empty()) {
+        m_job->deferred.Reject(Napi::Error::New(env, m_job->error).Value());
+        return;
+    }
+
+    size_t matchCount = 0;
+    for (uint8_t matched : m_job->matched) {
+        matchCount += matched;
+    }
+
+    Napi::Uint32Array result = Napi::Uint32Array::New(env, matchCount);
+    size_t j = 0;
+    for (size_t i = 0; i < m_job->matched.size(); i++) {
+        if (m_job->matched[i]) {
+            result[j++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    m_job->deferred.Resolve(result);
+}
@@ -0,0 +1,67 @@
+#ifndef NODE_PCRE2_FILTER_WORKER_H_
+#define NODE_PCRE2_FILTER_WORKER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <napi.h>
+#include <pcre2.h>
+#include "MatchDeadline.h"
+
+// State shared by all the workers of a single filterParallel call. Only
+// touched from the main thread, except for the disjoint slices of
+// subjects/matched owned by each worker while it executes.
+struct PCRE2FilterJob {
+    PCRE2FilterJob(Napi::Env env, const Napi::Object &pcre2, pcre2_code *re, uint32_t options);
+
+    Napi::Promise::Deferred deferred;
+    // Keeps the PCRE2 object, and thus re, alive until all workers are done
+    Napi::ObjectReference pcre2Ref;
+    pcre2_code *re;
+    uint32_t options;
+    // 0 for PCRE2's default
+    uint32_t matchLimit;
+    std::vector<std::u16string> subjects;
+    std::vector<uint8_t> matched;
+    size_t pending;
+    std::string error;
+
+    // Set by the abort listener of the signal option. Abortable jobs match
+    // with the callout enabled code of calloutCode, so that long matches
+    // can be abandoned too.
+    bool abortable;
+    std::atomic<bool> aborted;
+    std::shared_ptr<MatchDeadline> calloutCode;
+    Napi::ObjectReference signalRef;
+    Napi::FunctionReference abortListenerRef;
+};
+
+class PCRE2FilterWorker : public Napi::AsyncWorker {
+public:
+    PCRE2FilterWorker(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, size_t begin, size_t end);
+    virtual ~PCRE2FilterWorker();
+
+    PCRE2FilterWorker(const PCRE2FilterWorker&) = delete;
+    PCRE2FilterWorker& operator=(const PCRE2FilterWorker&) = delete;
+
+    static Napi::Value Start(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, size_t threads);
+    // Aborts the job when signal, an AbortSignal, fires
+    static void WatchSignal(Napi::Env env, std::shared_ptr<PCRE2FilterJob> job, const Napi::Object &signal);
+
+protected:
+    void Execute() override;
+    void OnOK() override;
+    void OnError(const Napi::Error &error) override;
+
+private:
+    static int AbortCallout(pcre2_callout_block *block, void *data);
+
+    void Done();
+
+    std::shared_ptr<PCRE2FilterJob> m_job;
+    size_t m_begin;
+    size_t m_end;
+};
+
+#endif // NODE_PCRE2_FILTER_WORKER_H_
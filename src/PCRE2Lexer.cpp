@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include "InstanceData.h"
+#include "PCRE2.h"
+#include "PCRE2Lexer.h"
+
+namespace {
+    // The rule of a token of characters no rule matches
+    const int32_t kErrorRule = -1;
+
+    // Returns the end of the character class starting at start
+    size_t SkipClass(const std::u16string &pattern, size_t start) {
+        size_t i = start + 1;
+        if (i < pattern.size() && pattern[i] == u'^') {
+            i++;
+        }
+        // A leading ] is a literal
+        if (i < pattern.size() && pattern[i] == u']') {
+            i++;
+        }
+        while (i < pattern.size()) {
+            if (pattern[i] == u'\\') {
+                i += 2;
+            } else if (pattern[i] == u'[' && i + 1 < pattern.size() && pattern[i + 1] == u':') {
+                size_t end = pattern.find(u":]", i + 2);
+                i = end == std::u16string::npos ? i + 1 : end + 2;
+            } else if (pattern[i] == u']') {
+                return i + 1;
+            } else {
+                i++;
+            }
+        }
+        return pattern.size();
+    }
+
+    // Looks for constructs that behave differently once a rule is an
+    // alternative of the combined pattern: recursion and subroutine calls,
+    // which would refer to the whole lexer or to groups of other rules,
+    // verbs that set the mark identifying the rule or cut the other
+    // alternatives off, and settings only allowed at the start of a pattern.
+    // Returns a description of the first one found, or an empty string.
+    std::string UnsupportedConstruct(const std::u16string &pattern, bool extended) {
+        size_t length = pattern.size();
+        size_t i = 0;
+        while (i < length) {
+            char16_t c = pattern[i];
+            char16_t next = i + 1 < length ? pattern[i + 1] : 0;
+            char16_t after = i + 2 < length ? pattern[i + 2] : 0;
+
+            if (c == u'\\') {
+                if (next == u'Q') {
+                    size_t end = pattern.find(u"\\E", i + 2);
+                    if (end == std::u16string::npos) {
+                        break;
+                    }
+                    i = end + 2;
+                    continue;
+                }
+                if (next == u'g' && (after == u'<' || after == u'\'')) {
+                    return "recursion and subroutine calls are not supported";
+                }
+                i += 2;
+                continue;
+            }
+
+            if (c == u'[') {
+                i = SkipClass(pattern, i);
+                continue;
+            }
+
+            if (c == u'#' && extended) {
+                i = pattern.find(u'\n', i);
+                if (i == std::u16string::npos) {
+                    break;
+                }
+                continue;
+            }
+
+            if (c == u'(' && next == u'*') {
+                // Lowercase names are the alphabetic lookaround and atomic
+                // group syntax, (*F) and (*FAIL) are harmless
+                std::string verb;
+                for (size_t j = i + 2; j < length && pattern[j] != u':' && pattern[j] != u')'; j++) {
+                    verb += pattern[j] < 0x80 ? static_cast<char>(pattern[j]) : '?';
+                }
+                if (verb.empty() || (verb[0] >= 'A' && verb[0] <= 'Z' && verb != "F" && verb != "FAIL")) {
+                    return (verb.empty() ? std::string("(*:NAME)") : "(*" + verb + ")") + " is not supported";
+                }
+            }
+
+            if (c == u'(' && next == u'?') {
+                if (after == u'#') {
+                    i = pattern.find(u')', i);
+                    if (i == std::u16string::npos) {
+                        break;
+                    }
+                    continue;
+                }
+
+                char16_t sign = i + 3 < length ? pattern[i + 3] : 0;
+                if ((after == u'R' && sign == u')') ||
+                    (after >= u'0' && after <= u'9') ||
+                    ((after == u'+' || after == u'-') && sign >= u'0' && sign <= u'9') ||
+                    after == u'&' ||
+                    (after == u'P' && sign == u'>'))
+                {
+                    return "recursion and subroutine calls are not supported";
+                }
+            }
+
+            i++;
+        }
+
+        return std::string();
+    }
+}
+
+Napi::Object PCRE2Lexer::Init(Napi::Env env, Napi::Object exports) {
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+
+    Napi::Function func = DefineClass(env, "PCRE2Lexer", {
+        InstanceMethod<&PCRE2Lexer::Tokenize>("tokenize"),
+        InstanceAccessor<&PCRE2Lexer::Names>("names"),
+    });
+
+    instanceData->PCRE2Lexer = Napi::Persistent(func);
+    exports.Set("PCRE2Lexer", func);
+
+    return exports;
+}
+
+PCRE2Lexer::PCRE2Lexer(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<PCRE2Lexer>(info)
+    , m_errorRecovery(false)
+{
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    if (!info[0].IsArray()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of rules");
+    }
+    Napi::Array rules = info[0].As<Napi::Array>();
+    if (rules.Length() == 0) {
+        throw Napi::TypeError::New(info.Env(), "Expected at least one rule");
+    }
+
+    std::string flags;
+    if (info.Length() > 1 && !info[1].IsUndefined()) {
+        flags = info[1].ToString().Utf8Value();
+    }
+    bool extended = flags.find('x') != std::string::npos;
+
+    Napi::Value options = info.Env().Undefined();
+    if (info.Length() > 2 && !info[2].IsUndefined()) {
+        options = info[2].ToObject();
+        m_errorRecovery = options.As<Napi::Object>().Get("errorRecovery").ToBoolean();
+    }
+
+    // Branch reset gives each rule its own group numbers, so that
+    // backreferences still refer to the rule's groups. Rules may reuse a
+    // group name, but not give different names to the same group number,
+    // which is checked here for a clearer error. \E closes a \Q left open at
+    // the end of a rule, and in extended mode a newline ends a trailing
+    // comment.
+    std::map<uint32_t, std::pair<std::u16string, uint32_t>> groupNames;
+    std::u16string combined = u"(?|";
+    uint32_t length = rules.Length();
+    for (uint32_t i = 0; i < length; i++) {
+        Napi::Value ruleValue = rules.Get(i);
+        if (!ruleValue.IsObject()) {
+            throw Napi::TypeError::New(info.Env(), "Expected rules to be objects");
+        }
+        Napi::Object rule = ruleValue.As<Napi::Object>();
+        std::string name = rule.Get("name").ToString().Utf8Value();
+        Napi::String pattern = rule.Get("pattern").ToString();
+
+        // Checked alone first, as a rule with unbalanced parentheses could
+        // otherwise break out of its alternative
+        PCRE2 *alone;
+        try {
+            alone = PCRE2::Unwrap(instanceData->PCRE2.New({ pattern, Napi::String::New(info.Env(), flags) }));
+        } catch (const Napi::Error &e) {
+            throw Napi::Error::New(info.Env(), "Invalid lexer rule '" + name + "': " + e.Message());
+        }
+
+        std::u16string patternStr = pattern.Utf16Value();
+        std::string unsupported = UnsupportedConstruct(patternStr, extended);
+        if (!unsupported.empty()) {
+            throw Napi::Error::New(info.Env(), "Invalid lexer rule '" + name + "': " + unsupported);
+        }
+
+        for (const auto &group : alone->GroupNames()) {
+            auto inserted = groupNames.emplace(group.first, std::make_pair(group.second, i));
+            if (!inserted.second && inserted.first->second.first != group.second) {
+                std::ostringstream oss;
+                oss << "Lexer rules '" << m_names[inserted.first->second.second] << "' and '" << name
+                    << "' give different names to capture group " << group.first;
+                throw Napi::Error::New(info.Env(), oss.str());
+            }
+        }
+
+        if (i > 0) {
+            combined += u"|";
+        }
+        combined += u"(?:";
+        combined += patternStr;
+        combined += extended ? u"\\E\n)(*MARK:" : u"\\E)(*MARK:";
+        for (char c : std::to_string(i)) {
+            combined += static_cast<char16_t>(c);
+        }
+        combined += u")";
+
+        m_names.push_back(name);
+        m_skip.push_back(rule.Get("skip").ToBoolean());
+    }
+    combined += u")";
+
+    if (flags.find('J') == std::string::npos) {
+        flags += "J";
+    }
+
+    Napi::Object pcre2 = instanceData->PCRE2.New({
+        Napi::String::New(info.Env(), combined),
+        Napi::String::New(info.Env(), flags),
+        options,
+    });
+    m_pcre2Ref = Napi::Persistent(pcre2);
+    m_pcre2 = PCRE2::Unwrap(pcre2);
+}
+
+PCRE2Lexer::~PCRE2Lexer() {}
+
+Napi::Value PCRE2Lexer::Tokenize(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    std::u16string subject = info[0].ToString().Utf16Value();
+
+    std::vector<int32_t> rules;
+    std::vector<int32_t> starts;
+    std::vector<int32_t> ends;
+
+    size_t position = 0;
+    while (position < subject.size()) {
+        size_t end;
+        PCRE2_SPTR mark;
+        if (m_pcre2->MatchToken(info.Env(), subject, position, end, mark)) {
+            // Every rule ends by setting its mark, and rules that could set
+            // another one are rejected up front
+            int32_t rule = mark != nullptr && *mark != 0 ? 0 : -1;
+            for (; rule >= 0 && *mark != 0; mark++) {
+                if (*mark < u'0' || *mark > u'9' || rule >= static_cast<int32_t>(m_skip.size())) {
+                    rule = -1;
+                    break;
+                }
+                rule = rule * 10 + (*mark - u'0');
+            }
+            if (rule < 0 || rule >= static_cast<int32_t>(m_skip.size())) {
+                throw Napi::Error::New(info.Env(), "PCRE2Lexer matched without identifying the rule");
+            }
+
+            if (!m_skip[rule]) {
+                rules.push_back(rule);
+                starts.push_back(static_cast<int32_t>(position));
+                ends.push_back(static_cast<int32_t>(end));
+            }
+            position = end;
+            continue;
+        }
+
+        if (!m_errorRecovery) {
+            Napi::Error error = Napi::Error::New(
+                info.Env(), "No lexer rule matches at offset " + std::to_string(position));
+            error.Set("offset", Napi::Number::New(info.Env(), static_cast<double>(position)));
+            throw error;
+        }
+
+        // Unmatched characters in a row make a single error token
+        size_t next = m_pcre2->AdvanceStringIndex(subject, position);
+        // Never split a surrogate pair, which in UTF mode would also make the
+        // next match attempt fail with a bad offset
+        if (next < subject.size() && (subject[next] & 0xfc00) == 0xdc00 &&
+            (subject[next - 1] & 0xfc00) == 0xd800) {
+            next++;
+        }
+        if (!rules.empty() && rules.back() == kErrorRule && ends.back() == static_cast<int32_t>(position)) {
+            ends.back() = static_cast<int32_t>(next);
+        } else {
+            rules.push_back(kErrorRule);
+            starts.push_back(static_cast<int32_t>(position));
+            ends.push_back(static_cast<int32_t>(next));
+        }
+        position = next;
+    }
+
+    Napi::Object result = Napi::Object::New(info.Env());
+    Napi::Int32Array rulesArray = Napi::Int32Array::New(info.Env(), rules.size());
+    Napi::Int32Array startsArray = Napi::Int32Array::New(info.Env(), starts.size());
+    Napi::Int32Array endsArray = Napi::Int32Array::New(info.Env(), ends.size());
+    std::copy(rules.begin(), rules.end(), rulesArray.Data());
+    std::copy(starts.begin(), starts.end(), startsArray.Data());
+    std::copy(ends.begin(), ends.end(), endsArray.Data());
+    result["rules"] = rulesArray;
+    result["starts"] = startsArray;
+    result["ends"] = endsArray;
+    return result;
+}
+
+Napi::Value PCRE2Lexer::Names(const Napi::CallbackInfo &info) {
+    Napi::Array result = Napi::Array::New(info.Env(), m_names.size());
+    for (size_t i = 0; i < m_names.size(); i++) {
+        result[i] = m_names[i];
+    }
+
+    return result;
+}
@@ -0,0 +1,36 @@
+#ifndef NODE_PCRE2_LEXER_H_
+#define NODE_PCRE2_LEXER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <napi.h>
+
+class PCRE2;
+
+// Tokenizes a subject with an ordered list of rules in a single call. The
+// rules are compiled into one pattern, an alternation in a branch reset group
+// with a (*MARK) after each rule naming it, which is matched anchored at each
+// position in turn. As with a loop of sticky patterns, the first rule that
+// matches at a position wins.
+class PCRE2Lexer : public Napi::ObjectWrap<PCRE2Lexer> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    explicit PCRE2Lexer(const Napi::CallbackInfo &info);
+    virtual ~PCRE2Lexer();
+
+    PCRE2Lexer(const PCRE2Lexer&) = delete;
+    PCRE2Lexer& operator=(const PCRE2Lexer&) = delete;
+
+private:
+    Napi::Value Tokenize(const Napi::CallbackInfo &info);
+    Napi::Value Names(const Napi::CallbackInfo &info);
+
+    Napi::ObjectReference m_pcre2Ref;
+    PCRE2 *m_pcre2;
+    std::vector<std::string> m_names;
+    std::vector<bool> m_skip;
+    bool m_errorRecovery;
+};
+
+#endif // NODE_PCRE2_LEXER_H_
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <unordered_map>
+#include "InstanceData.h"
+#include "PCRE2.h"
+#include "PCRE2RuleIndex.h"
+
+namespace {
+    // Literals are cut to this many code units, which keeps the automaton
+    // small while still rarely matching by chance
+    const size_t kMaxLiteralLength = 16;
+}
+
+Napi::Object PCRE2RuleIndex::Init(Napi::Env env, Napi::Object exports) {
+    InstanceData *instanceData = env.GetInstanceData<InstanceData>();
+
+    Napi::Function func = DefineClass(env, "PCRE2RuleIndex", {
+        InstanceMethod<&PCRE2RuleIndex::Candidates>("candidates"),
+        InstanceMethod<&PCRE2RuleIndex::Match>("match"),
+        InstanceAccessor<&PCRE2RuleIndex::Size>("size"),
+        InstanceAccessor<&PCRE2RuleIndex::AlwaysChecked>("alwaysChecked"),
+    });
+
+    instanceData->PCRE2RuleIndex = Napi::Persistent(func);
+    exports.Set("PCRE2RuleIndex", func);
+
+    return exports;
+}
+
+PCRE2RuleIndex::PCRE2RuleIndex(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<PCRE2RuleIndex>(info)
+{
+    InstanceData *instanceData = info.Env().GetInstanceData<InstanceData>();
+
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    if (!info[0].IsArray()) {
+        throw Napi::TypeError::New(info.Env(), "Expected an array of patterns");
+    }
+    Napi::Array rules = info[0].As<Napi::Array>();
+
+    std::vector<std::u16string> literals;
+    std::unordered_map<std::u16string, uint32_t> literalIds;
+
+    uint32_t length = rules.Length();
+    m_rules.reserve(length);
+    m_ruleRefs.reserve(length);
+    for (uint32_t i = 0; i < length; i++) {
+        // Anything else is compiled like new PCRE2 would
+        Napi::Value rule = rules.Get(i);
+        if (!PCRE2::IsPCRE2(rule)) {
+            rule = instanceData->PCRE2.New({ rule });
+        }
+
+        PCRE2 *pcre2 = PCRE2::Unwrap(rule.As<Napi::Object>());
+        m_ruleRefs.push_back(Napi::Persistent(rule.As<Napi::Object>()));
+        m_rules.push_back(pcre2);
+
+        std::vector<std::u16string> ruleLiterals = pcre2->FilterLiterals();
+        if (ruleLiterals.empty()) {
+            m_alwaysChecked.push_back(i);
+            continue;
+        }
+
+        for (const std::u16string &literal : ruleLiterals) {
+            std::u16string key = literal.substr(0, kMaxLiteralLength);
+            std::transform(key.begin(), key.end(), key.begin(), AhoCorasick::Fold);
+
+            auto inserted = literalIds.emplace(key, static_cast<uint32_t>(literals.size()));
+            if (inserted.second) {
+                literals.push_back(key);
+                m_literalRules.emplace_back();
+            }
+
+            std::vector<uint32_t> &literalRules = m_literalRules[inserted.first->second];
+            if (literalRules.empty() || literalRules.back() != i) {
+                literalRules.push_back(i);
+            }
+        }
+    }
+
+    m_automaton = std::make_unique<AhoCorasick>(literals);
+    m_seen.assign(literals.size(), 0);
+}
+
+PCRE2RuleIndex::~PCRE2RuleIndex() {}
+
+void PCRE2RuleIndex::FindCandidates(const std::u16string &subject, std::vector<uint32_t> &candidates) {
+    m_found.clear();
+    m_automaton->Scan(subject.c_str(), subject.size(), m_seen, m_found);
+
+    candidates = m_alwaysChecked;
+    for (uint32_t literal : m_found) {
+        m_seen[literal] = 0;
+        const std::vector<uint32_t> &literalRules = m_literalRules[literal];
+        candidates.insert(candidates.end(), literalRules.begin(), literalRules.end());
+    }
+
+    // A rule may have several literals in the subject
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
+Napi::Value PCRE2RuleIndex::Candidates(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    std::vector<uint32_t> candidates;
+    FindCandidates(info[0].ToString().Utf16Value(), candidates);
+
+    Napi::Uint32Array result = Napi::Uint32Array::New(info.Env(), candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        result[i] = candidates[i];
+    }
+
+    return result;
+}
+
+Napi::Value PCRE2RuleIndex::Match(const Napi::CallbackInfo &info) {
+    if (info.Length() < 1) {
+        throw Napi::TypeError::New(info.Env(), "Wrong number of arguments");
+    }
+
+    std::u16string subject = info[0].ToString().Utf16Value();
+
+    std::vector<uint32_t> candidates;
+    FindCandidates(subject, candidates);
+
+    std::vector<uint32_t> matches;
+    for (uint32_t rule : candidates) {
+        if (m_rules[rule]->TestSubject(info.Env(), subject)) {
+            matches.push_back(rule);
+        }
+    }
+
+    Napi::Uint32Array result = Napi::Uint32Array::New(info.Env(), matches.size());
+    for (size_t i = 0; i < matches.size(); i++) {
+        result[i] = matches[i];
+    }
+
+    return result;
+}
+
+Napi::Value PCRE2RuleIndex::Size(const Napi::CallbackInfo &info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(m_rules.size()));
+}
+
+Napi::Value PCRE2RuleIndex::AlwaysChecked(const Napi::CallbackInfo &info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(m_alwaysChecked.size()));
+}
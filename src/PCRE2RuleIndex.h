@@ -0,0 +1,44 @@
+#ifndef NODE_PCRE2_RULE_INDEX_H_
+#define NODE_PCRE2_RULE_INDEX_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <napi.h>
+#include "AhoCorasick.h"
+
+class PCRE2;
+
+// Matches a subject against a collection of patterns, only running the ones
+// whose required literals appear in it. The literals of all the patterns are
+// found in a single scan of the subject, patterns without any are always run.
+class PCRE2RuleIndex : public Napi::ObjectWrap<PCRE2RuleIndex> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    explicit PCRE2RuleIndex(const Napi::CallbackInfo &info);
+    virtual ~PCRE2RuleIndex();
+
+    PCRE2RuleIndex(const PCRE2RuleIndex&) = delete;
+    PCRE2RuleIndex& operator=(const PCRE2RuleIndex&) = delete;
+
+private:
+    Napi::Value Candidates(const Napi::CallbackInfo &info);
+    Napi::Value Match(const Napi::CallbackInfo &info);
+    Napi::Value Size(const Napi::CallbackInfo &info);
+    Napi::Value AlwaysChecked(const Napi::CallbackInfo &info);
+
+    // The rules to run on the subject, in order
+    void FindCandidates(const std::u16string &subject, std::vector<uint32_t> &candidates);
+
+    std::vector<Napi::ObjectReference> m_ruleRefs;
+    std::vector<PCRE2*> m_rules;
+    std::unique_ptr<AhoCorasick> m_automaton;
+    // The rules each literal was taken from
+    std::vector<std::vector<uint32_t>> m_literalRules;
+    std::vector<uint32_t> m_alwaysChecked;
+    // Scratch space for scans
+    std::vector<uint8_t> m_seen;
+    std::vector<uint32_t> m_found;
+};
+
+#endif // NODE_PCRE2_RULE_INDEX_H_
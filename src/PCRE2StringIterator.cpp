@@ -25,7 +25,7 @@ PCRE2StringIterator::PCRE2StringIterator(const Napi::CallbackInfo &info)
 
     m_private = Napi::Persistent(Napi::Object::New(info.Env()));
     m_private.Set("subject", info[1]);
-    m_subject = info[1].As<Napi::String>().Utf16Value();
+    m_subject = std::make_shared<const std::u16string>(info[1].As<Napi::String>().Utf16Value());
 }
 
 PCRE2StringIterator::~PCRE2StringIterator() {}
@@ -43,7 +43,7 @@ Napi::Value PCRE2StringIterator::Next(const Napi::CallbackInfo &info) {
     }
 
     while (true) {
-        Napi::Array match = m_pcre2->ExecImpl(info.Env(), m_private.Get("subject").As<Napi::String>(), m_options).As<Napi::Array>();
+        Napi::Array match = m_pcre2->ExecImpl(info.Env(), m_private.Get("subject").As<Napi::String>(), m_subject, m_options).As<Napi::Array>();
         if (match.IsNull()) {
             if (m_options == 0) {
                 m_done = true;
@@ -51,7 +51,7 @@ Napi::Value PCRE2StringIterator::Next(const Napi::CallbackInfo &info) {
                 return result;
             }
 
-            m_pcre2->SetLastIndex(m_pcre2->AdvanceStringIndex(m_subject, m_pcre2->LastIndex()));
+            m_pcre2->SetLastIndex(m_pcre2->AdvanceStringIndex(*m_subject, m_pcre2->LastIndex()));
             continue;
         }
 
@@ -63,7 +63,7 @@ Napi::Value PCRE2StringIterator::Next(const Napi::CallbackInfo &info) {
 
         m_options = 0;
         if (match.Get(0u).As<Napi::String>().Utf16Value().empty()) {
-            if (m_pcre2->LastIndex() == m_subject.length()) {
+            if (m_pcre2->LastIndex() == m_subject->length()) {
                 m_done = true;
                 return result;
             }
@@ -71,7 +71,7 @@ Napi::Value PCRE2StringIterator::Next(const Napi::CallbackInfo &info) {
             if (m_pcre2->PCRE2Mode()) {
                 m_options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
             } else {
-                m_pcre2->SetLastIndex(m_pcre2->AdvanceStringIndex(m_subject, m_pcre2->LastIndex()));
+                m_pcre2->SetLastIndex(m_pcre2->AdvanceStringIndex(*m_subject, m_pcre2->LastIndex()));
             }
         }
 
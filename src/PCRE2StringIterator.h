@@ -1,6 +1,8 @@
 #ifndef NODE_PCRE2_MATCH_ALL_ITERATOR_H_
 #define NODE_PCRE2_MATCH_ALL_ITERATOR_H_
 
+#include <memory>
+#include <string>
 #include <napi.h>
 
 class PCRE2;
@@ -19,7 +21,7 @@ private:
     Napi::Value Next(const Napi::CallbackInfo &info);
 
     Napi::ObjectReference m_private;
-    std::u16string m_subject;
+    std::shared_ptr<const std::u16string> m_subject;
     Napi::ObjectReference m_pcre2Ref;
     PCRE2 *m_pcre2;
     uint32_t m_options;
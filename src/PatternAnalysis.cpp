@@ -0,0 +1,1193 @@
+#include <algorithm>
+#include <utility>
+#include <pcre2.h>
+#include "PatternAnalysis.h"
+
+namespace {
+    const uint32_t kMaxCodePoint = 0x10ffff;
+    const uint32_t kUnbounded = UINT32_MAX;
+    // Counted repeats with a larger maximum backtrack like unbounded ones
+    const uint32_t kLargeRepeat = 16;
+    // Longer fixed length nodes are not compared character by character
+    const size_t kMaxShapeLength = 64;
+    const size_t kUnboundedLength = SIZE_MAX;
+
+    size_t AddLengths(size_t a, size_t b) {
+        return a > kUnboundedLength - b ? kUnboundedLength : a + b;
+    }
+
+    size_t MultiplyLength(size_t length, uint32_t count) {
+        if (length == 0 || count == 0) {
+            return 0;
+        }
+        if (count == kUnbounded || length > kUnboundedLength / count) {
+            return kUnboundedLength;
+        }
+        return length * count;
+    }
+
+    class CharSet {
+    public:
+        static CharSet Any() {
+            CharSet set;
+            set.Add(0, kMaxCodePoint);
+            return set;
+        }
+
+        void Add(uint32_t lo, uint32_t hi) {
+            m_ranges.emplace_back(std::min(lo, hi), std::max(lo, hi));
+            Normalize();
+        }
+
+        void Add(const CharSet &other) {
+            m_ranges.insert(m_ranges.end(), other.m_ranges.begin(), other.m_ranges.end());
+            Normalize();
+        }
+
+        // Adds the other case of ASCII letters
+        void AddCaseless() {
+            std::vector<std::pair<uint32_t, uint32_t>> ranges = m_ranges;
+            for (const auto &range : ranges) {
+                for (uint32_t base : { static_cast<uint32_t>('A'), static_cast<uint32_t>('a') }) {
+                    uint32_t lo = std::max(range.first, base);
+                    uint32_t hi = std::min(range.second, base + 25);
+                    if (lo <= hi) {
+                        uint32_t other = base == 'A' ? 'a' : 'A';
+                        Add(lo - base + other, hi - base + other);
+                    }
+                }
+            }
+        }
+
+        CharSet Negated() const {
+            CharSet set;
+            uint32_t next = 0;
+            for (const auto &range : m_ranges) {
+                if (range.first > next) {
+                    set.m_ranges.emplace_back(next, range.first - 1);
+                }
+                next = range.second + 1;
+            }
+            if (next <= kMaxCodePoint) {
+                set.m_ranges.emplace_back(next, kMaxCodePoint);
+            }
+            return set;
+        }
+
+        bool Overlaps(const CharSet &other) const {
+            size_t i = 0;
+            size_t j = 0;
+            while (i < m_ranges.size() && j < other.m_ranges.size()) {
+                if (m_ranges[i].second < other.m_ranges[j].first) {
+                    i++;
+                } else if (other.m_ranges[j].second < m_ranges[i].first) {
+                    j++;
+                } else {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool Empty() const {
+            return m_ranges.empty();
+        }
+
+        uint32_t Max() const {
+            return m_ranges.empty() ? 0 : m_ranges.back().second;
+        }
+
+    private:
+        void Normalize() {
+            std::sort(m_ranges.begin(), m_ranges.end());
+            std::vector<std::pair<uint32_t, uint32_t>> merged;
+            for (const auto &range : m_ranges) {
+                if (!merged.empty() && range.first <= merged.back().second + 1) {
+                    merged.back().second = std::max(merged.back().second, range.second);
+                } else {
+                    merged.push_back(range);
+                }
+            }
+            m_ranges = std::move(merged);
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    };
+
+    struct Node {
+        enum class Kind {
+            Empty,
+            Atom,
+            Sequence,
+            Alternation,
+            Repeat,
+            Atomic,
+            Lookaround,
+        };
+
+        Kind kind = Kind::Empty;
+        size_t start = 0;
+        size_t end = 0;
+        std::vector<Node> children;
+        uint32_t min = 1;
+        uint32_t max = 1;
+        bool possessive = false;
+
+        bool nullable = true;
+        // The characters the node may start with, and may consume
+        CharSet first;
+        CharSet all;
+        // Whether the node always matches shape.size() characters, each from
+        // the corresponding set
+        bool fixed = true;
+        std::vector<CharSet> shape;
+        // The most code units the node may consume, and look at from where
+        // it starts, including lookaheads
+        size_t width = 0;
+        size_t reach = 0;
+
+        bool LargeRepeat() const {
+            return kind == Kind::Repeat && !possessive && (max == kUnbounded || max > kLargeRepeat) && !all.Empty();
+        }
+    };
+
+    Node MakeEmpty(size_t start, size_t end) {
+        Node node;
+        node.start = start;
+        node.end = end;
+        return node;
+    }
+
+    Node MakeAtom(const CharSet &set, size_t start, size_t end) {
+        Node node;
+        node.kind = Node::Kind::Atom;
+        node.start = start;
+        node.end = end;
+        node.nullable = false;
+        node.first = set;
+        node.all = set;
+        node.shape.push_back(set);
+        node.width = set.Max() > 0xffff ? 2 : 1;
+        node.reach = node.width;
+        return node;
+    }
+
+    // Backreferences, recursion and the like, which may match anything
+    Node MakeUnknown(bool nullable, size_t start, size_t end) {
+        Node node = MakeAtom(CharSet::Any(), start, end);
+        node.nullable = nullable;
+        node.fixed = false;
+        node.shape.clear();
+        node.width = kUnboundedLength;
+        node.reach = kUnboundedLength;
+        return node;
+    }
+
+    Node MakeSequence(std::vector<Node> children, size_t start, size_t end) {
+        if (children.empty()) {
+            return MakeEmpty(start, end);
+        }
+        if (children.size() == 1) {
+            return std::move(children[0]);
+        }
+
+        Node node;
+        node.kind = Node::Kind::Sequence;
+        node.start = start;
+        node.end = end;
+        for (const Node &child : children) {
+            if (node.nullable) {
+                node.first.Add(child.first);
+            }
+            node.nullable = node.nullable && child.nullable;
+            node.all.Add(child.all);
+            node.reach = std::max(node.reach, AddLengths(node.width, child.reach));
+            node.width = AddLengths(node.width, child.width);
+            node.fixed = node.fixed && child.fixed && node.shape.size() + child.shape.size() <= kMaxShapeLength;
+            if (node.fixed) {
+                node.shape.insert(node.shape.end(), child.shape.begin(), child.shape.end());
+            }
+        }
+        if (!node.fixed) {
+            node.shape.clear();
+        }
+        node.children = std::move(children);
+        return node;
+    }
+
+    Node MakeAlternation(std::vector<Node> children, size_t start, size_t end) {
+        if (children.size() == 1) {
+            return std::move(children[0]);
+        }
+
+        Node node;
+        node.kind = Node::Kind::Alternation;
+        node.start = start;
+        node.end = end;
+        node.nullable = false;
+        node.shape = children[0].shape;
+        for (const Node &child : children) {
+            node.nullable = node.nullable || child.nullable;
+            node.first.Add(child.first);
+            node.all.Add(child.all);
+            node.width = std::max(node.width, child.width);
+            node.reach = std::max(node.reach, child.reach);
+            node.fixed = node.fixed && child.fixed && child.shape.size() == node.shape.size();
+            for (size_t i = 0; node.fixed && i < node.shape.size(); i++) {
+                node.shape[i].Add(child.shape[i]);
+            }
+        }
+        if (!node.fixed) {
+            node.shape.clear();
+        }
+        node.children = std::move(children);
+        return node;
+    }
+
+    Node MakeRepeat(Node child, uint32_t min, uint32_t max, bool possessive, size_t start, size_t end) {
+        Node node;
+        node.kind = Node::Kind::Repeat;
+        node.start = start;
+        node.end = end;
+        node.min = min;
+        node.max = max;
+        node.possessive = possessive;
+        node.nullable = min == 0 || child.nullable;
+        node.first = child.first;
+        node.all = child.all;
+        node.width = MultiplyLength(child.width, max);
+        node.reach = max == 0 ? 0 : AddLengths(MultiplyLength(child.width, max == kUnbounded ? max : max - 1), child.reach);
+        node.fixed =
+            child.fixed && min == max &&
+            (child.shape.empty() || min <= kMaxShapeLength / child.shape.size());
+        if (node.fixed) {
+            for (uint32_t i = 0; i < min; i++) {
+                node.shape.insert(node.shape.end(), child.shape.begin(), child.shape.end());
+            }
+        }
+        node.children.push_back(std::move(child));
+        return node;
+    }
+
+    Node MakeGroup(Node::Kind kind, Node child, size_t start, size_t end) {
+        Node node;
+        node.kind = kind;
+        node.start = start;
+        node.end = end;
+        // Lookbehinds are counted as if they looked ahead, which only
+        // overestimates
+        node.width = kind == Node::Kind::Atomic ? child.width : 0;
+        node.reach = child.reach;
+        if (kind == Node::Kind::Atomic) {
+            node.nullable = child.nullable;
+            node.first = child.first;
+            node.all = child.all;
+            node.fixed = child.fixed;
+            node.shape = child.shape;
+        }
+        node.children.push_back(std::move(child));
+        return node;
+    }
+
+    class Parser {
+    public:
+        Parser(const std::u16string &pattern, uint32_t options)
+            : m_pattern(pattern)
+            , m_options(options)
+            , m_pos(0)
+            , m_caseless((options & PCRE2_CASELESS) != 0)
+            , m_extended((options & PCRE2_EXTENDED) != 0)
+        {
+        }
+
+        Node Parse() {
+            std::vector<Node> parts;
+            parts.push_back(ParseAlternation());
+            // Unbalanced parentheses would have failed compilation, but don't
+            // stop early if one does show up
+            while (!AtEnd()) {
+                m_pos++;
+                parts.push_back(ParseAlternation());
+            }
+            return MakeSequence(std::move(parts), 0, m_pattern.size());
+        }
+
+    private:
+        enum class EscapeKind {
+            Char,
+            Set,
+            ZeroWidth,
+            Backreference,
+            Unknown,
+        };
+
+        bool AtEnd() const {
+            return m_pos >= m_pattern.size();
+        }
+
+        char16_t Peek(size_t offset = 0) const {
+            return m_pos + offset < m_pattern.size() ? m_pattern[m_pos + offset] : 0;
+        }
+
+        uint32_t NextCodePoint() {
+            uint32_t c = m_pattern[m_pos++];
+            if (c >= 0xd800 && c <= 0xdbff && !AtEnd() && Peek() >= 0xdc00 && Peek() <= 0xdfff) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (m_pattern[m_pos++] - 0xdc00);
+            }
+            return c;
+        }
+
+        void SkipTo(char16_t c) {
+            while (!AtEnd() && m_pattern[m_pos] != c) {
+                m_pos++;
+            }
+            if (!AtEnd()) {
+                m_pos++;
+            }
+        }
+
+        void SkipExtended() {
+            while (m_extended && !AtEnd()) {
+                char16_t c = Peek();
+                if (c == ' ' || (c >= '\t' && c <= '\r')) {
+                    m_pos++;
+                } else if (c == '#') {
+                    SkipTo('\n');
+                } else {
+                    break;
+                }
+            }
+        }
+
+        CharSet Literal(uint32_t c) const {
+            CharSet set;
+            set.Add(c, c);
+            if (m_caseless) {
+                set.AddCaseless();
+            }
+            return set;
+        }
+
+        Node ParseAlternation() {
+            size_t start = m_pos;
+            std::vector<Node> branches;
+            branches.push_back(ParseSequence());
+            while (Peek() == '|') {
+                m_pos++;
+                branches.push_back(ParseSequence());
+            }
+            return MakeAlternation(std::move(branches), start, m_pos);
+        }
+
+        Node ParseSequence() {
+            size_t start = m_pos;
+            std::vector<Node> items;
+            while (true) {
+                SkipExtended();
+                if (AtEnd() || Peek() == '|' || Peek() == ')') {
+                    break;
+                }
+
+                size_t atomStart = m_pos;
+                Node atom = ParseAtom();
+                SkipExtended();
+                ParseQuantifiers(atom, atomStart);
+                items.push_back(std::move(atom));
+            }
+            return MakeSequence(std::move(items), start, m_pos);
+        }
+
+        Node ParseAtom() {
+            size_t start = m_pos;
+            switch (Peek()) {
+                case '(':
+                    return ParseGroup();
+                case '[':
+                    m_pos++;
+                    return MakeAtom(ParseClass(), start, m_pos);
+                case '\\':
+                    return ParseEscapeAtom();
+                case '.':
+                    m_pos++;
+                    return MakeAtom(CharSet::Any(), start, m_pos);
+                case '^':
+                case '$':
+                    m_pos++;
+                    return MakeEmpty(start, m_pos);
+                default: {
+                    uint32_t c = NextCodePoint();
+                    return MakeAtom(Literal(c), start, m_pos);
+                }
+            }
+        }
+
+        void ParseQuantifiers(Node &atom, size_t atomStart) {
+            while (!AtEnd()) {
+                uint32_t min;
+                uint32_t max;
+                char16_t c = Peek();
+                if (c == '*') {
+                    min = 0;
+                    max = kUnbounded;
+                    m_pos++;
+                } else if (c == '+') {
+                    min = 1;
+                    max = kUnbounded;
+                    m_pos++;
+                } else if (c == '?') {
+                    min = 0;
+                    max = 1;
+                    m_pos++;
+                } else if (c != '{' || !ParseBraces(min, max)) {
+                    break;
+                }
+
+                bool possessive = false;
+                if (Peek() == '+') {
+                    possessive = true;
+                    m_pos++;
+                } else if (Peek() == '?') {
+                    m_pos++;
+                }
+
+                atom = MakeRepeat(std::move(atom), min, max, possessive, atomStart, m_pos);
+                SkipExtended();
+            }
+        }
+
+        // {n}, {n,}, {n,m} and {,m}, anything else is a literal brace
+        bool ParseBraces(uint32_t &min, uint32_t &max) {
+            size_t pos = m_pos + 1;
+            auto skipSpaces = [&]() {
+                while (pos < m_pattern.size() && (m_pattern[pos] == ' ' || m_pattern[pos] == '\t')) {
+                    pos++;
+                }
+            };
+            auto number = [&](uint32_t &value) {
+                size_t begin = pos;
+                uint64_t result = 0;
+                while (pos < m_pattern.size() && m_pattern[pos] >= '0' && m_pattern[pos] <= '9') {
+                    result = std::min<uint64_t>(result * 10 + (m_pattern[pos] - '0'), kUnbounded - 1);
+                    pos++;
+                }
+                value = static_cast<uint32_t>(result);
+                return pos != begin;
+            };
+
+            skipSpaces();
+            bool hasMin = number(min);
+            skipSpaces();
+            if (pos < m_pattern.size() && m_pattern[pos] == ',') {
+                pos++;
+                skipSpaces();
+                if (!number(max)) {
+                    max = kUnbounded;
+                    if (!hasMin) {
+                        return false;
+                    }
+                }
+                skipSpaces();
+                if (!hasMin) {
+                    min = 0;
+                }
+            } else if (hasMin) {
+                max = min;
+            } else {
+                return false;
+            }
+
+            if (pos >= m_pattern.size() || m_pattern[pos] != '}') {
+                return false;
+            }
+
+            m_pos = pos + 1;
+            return true;
+        }
+
+        Node ParseGroup() {
+            size_t start = m_pos;
+            m_pos++;
+
+            bool caseless = m_caseless;
+            bool extended = m_extended;
+            Node::Kind kind = Node::Kind::Sequence;
+            Node inner;
+
+            if (Peek() == '*') {
+                // Verbs, and alphabetic assertions such as (*atomic:...)
+                size_t nameStart = ++m_pos;
+                while (!AtEnd() && Peek() != ':' && Peek() != ')') {
+                    m_pos++;
+                }
+                std::u16string name = m_pattern.substr(nameStart, m_pos - nameStart);
+                if (Peek() == ':' && !name.empty() && name != u"MARK" && name != u"PRUNE" && name != u"SKIP" && name != u"THEN") {
+                    m_pos++;
+                    if (name == u"atomic" || name == u"asr" || name == u"atomic_script_run") {
+                        kind = Node::Kind::Atomic;
+                    } else if (name != u"sr" && name != u"script_run") {
+                        kind = Node::Kind::Lookaround;
+                    }
+                    inner = ParseAlternation();
+                } else {
+                    SkipTo(')');
+                    return MakeEmpty(start, m_pos);
+                }
+            } else if (Peek() == '?') {
+                m_pos++;
+                char16_t c = Peek();
+                if (c == '#' || c == 'C') {
+                    SkipTo(')');
+                    return MakeEmpty(start, m_pos);
+                } else if (c == ':' || c == '|') {
+                    m_pos++;
+                    inner = ParseAlternation();
+                } else if (c == '>') {
+                    m_pos++;
+                    kind = Node::Kind::Atomic;
+                    inner = ParseAlternation();
+                } else if (c == '=' || c == '!' || c == '*' ||
+                    (c == '<' && (Peek(1) == '=' || Peek(1) == '!' || Peek(1) == '*')))
+                {
+                    m_pos += c == '<' ? 2 : 1;
+                    kind = Node::Kind::Lookaround;
+                    inner = ParseAlternation();
+                } else if (c == '<' || c == '\'' || (c == 'P' && Peek(1) == '<')) {
+                    m_pos++;
+                    SkipTo(c == '\'' ? '\'' : '>');
+                    inner = ParseAlternation();
+                } else if (c == 'P' || c == 'R' || c == '&' || c == '+' || c == '-' || (c >= '0' && c <= '9')) {
+                    if (c == '-' && !(Peek(1) >= '0' && Peek(1) <= '9')) {
+                        return ParseOptionSetting(start, caseless, extended);
+                    }
+                    // Backreference or recursion
+                    SkipTo(')');
+                    return MakeUnknown(true, start, m_pos);
+                } else if (c == '(') {
+                    // Conditional group, the condition itself doesn't consume
+                    // but may look ahead
+                    size_t conditionReach = 0;
+                    if (Peek(1) == '?' || Peek(1) == '*') {
+                        conditionReach = ParseGroup().reach;
+                    } else {
+                        SkipTo(')');
+                    }
+                    inner = ParseAlternation();
+                    inner.reach = std::max(inner.reach, conditionReach);
+                } else {
+                    return ParseOptionSetting(start, caseless, extended);
+                }
+            } else {
+                inner = ParseAlternation();
+            }
+
+            if (Peek() == ')') {
+                m_pos++;
+            }
+
+            m_caseless = caseless;
+            m_extended = extended;
+
+            if (kind == Node::Kind::Sequence) {
+                return inner;
+            }
+            return MakeGroup(kind, std::move(inner), start, m_pos);
+        }
+
+        // (?i) applies to the rest of the enclosing group, (?i:...) to its
+        // own contents
+        Node ParseOptionSetting(size_t start, bool caseless, bool extended) {
+            bool on = true;
+            while (!AtEnd() && Peek() != ')' && Peek() != ':') {
+                switch (Peek()) {
+                    case '-':
+                        on = false;
+                        break;
+                    case '^':
+                        m_caseless = false;
+                        m_extended = false;
+                        break;
+                    case 'i':
+                        m_caseless = on;
+                        break;
+                    case 'x':
+                        m_extended = on;
+                        break;
+                }
+                m_pos++;
+            }
+
+            if (Peek() == ')') {
+                m_pos++;
+                return MakeEmpty(start, m_pos);
+            }
+
+            m_pos++;
+            Node inner = ParseAlternation();
+            if (Peek() == ')') {
+                m_pos++;
+            }
+            m_caseless = caseless;
+            m_extended = extended;
+            return inner;
+        }
+
+        Node ParseEscapeAtom() {
+            size_t start = m_pos;
+
+            if (Peek(1) == 'Q') {
+                m_pos += 2;
+                std::vector<Node> chars;
+                while (!AtEnd() && !(Peek() == '\\' && Peek(1) == 'E')) {
+                    size_t charStart = m_pos;
+                    uint32_t c = NextCodePoint();
+                    chars.push_back(MakeAtom(Literal(c), charStart, m_pos));
+                }
+                if (!AtEnd()) {
+                    m_pos += 2;
+                }
+                return MakeSequence(std::move(chars), start, m_pos);
+            }
+
+            uint32_t c;
+            CharSet set;
+            switch (ParseEscape(false, c, set)) {
+                case EscapeKind::Char:
+                    return MakeAtom(Literal(c), start, m_pos);
+                case EscapeKind::Set:
+                    return MakeAtom(set, start, m_pos);
+                case EscapeKind::ZeroWidth:
+                    return MakeEmpty(start, m_pos);
+                case EscapeKind::Backreference:
+                    return MakeUnknown(true, start, m_pos);
+                case EscapeKind::Unknown:
+                default:
+                    return MakeUnknown(false, start, m_pos);
+            }
+        }
+
+        // Parses the escape at m_pos, the result is either a single character
+        // in c, or a set of characters in set
+        EscapeKind ParseEscape(bool inClass, uint32_t &c, CharSet &set) {
+            m_pos++;
+            if (AtEnd()) {
+                c = '\\';
+                return EscapeKind::Char;
+            }
+
+            char16_t e = Peek();
+            switch (e) {
+                case 'd':
+                case 'D':
+                    m_pos++;
+                    set.Add('0', '9');
+                    return Negate(set, e == 'D');
+                case 'w':
+                case 'W':
+                    m_pos++;
+                    set.Add('0', '9');
+                    set.Add('A', 'Z');
+                    set.Add('a', 'z');
+                    set.Add('_', '_');
+                    if (m_options & PCRE2_UCP) {
+                        set.Add(0x80, kMaxCodePoint);
+                    }
+                    return Negate(set, e == 'W');
+                case 's':
+                case 'S':
+                    m_pos++;
+                    set.Add('\t', '\r');
+                    set.Add(' ', ' ');
+                    if (m_options & PCRE2_UCP) {
+                        AddHorizontalSpace(set);
+                        AddVerticalSpace(set);
+                    }
+                    return Negate(set, e == 'S');
+                case 'h':
+                case 'H':
+                    m_pos++;
+                    AddHorizontalSpace(set);
+                    return Negate(set, e == 'H');
+                case 'v':
+                case 'V':
+                    m_pos++;
+                    AddVerticalSpace(set);
+                    return Negate(set, e == 'V');
+                case 'N':
+                    m_pos++;
+                    set.Add('\n', '\n');
+                    return Negate(set, true);
+                case 'p':
+                case 'P':
+                    m_pos++;
+                    if (Peek() == '{') {
+                        SkipTo('}');
+                    } else if (!AtEnd()) {
+                        m_pos++;
+                    }
+                    set = CharSet::Any();
+                    return EscapeKind::Set;
+                case 'R':
+                case 'X':
+                    m_pos++;
+                    if (inClass) {
+                        c = e;
+                        return EscapeKind::Char;
+                    }
+                    return EscapeKind::Unknown;
+                case 'b':
+                    m_pos++;
+                    if (inClass) {
+                        c = '\b';
+                        return EscapeKind::Char;
+                    }
+                    return EscapeKind::ZeroWidth;
+                case 'B':
+                case 'A':
+                case 'z':
+                case 'Z':
+                case 'G':
+                case 'K':
+                case 'E':
+                    m_pos++;
+                    return EscapeKind::ZeroWidth;
+                case 'g':
+                case 'k':
+                    m_pos++;
+                    if (Peek() == '{') {
+                        SkipTo('}');
+                    } else if (Peek() == '<') {
+                        SkipTo('>');
+                    } else if (Peek() == '\'') {
+                        m_pos++;
+                        SkipTo('\'');
+                    } else {
+                        if (Peek() == '+' || Peek() == '-') {
+                            m_pos++;
+                        }
+                        while (Peek() >= '0' && Peek() <= '9') {
+                            m_pos++;
+                        }
+                    }
+                    return EscapeKind::Backreference;
+                case 'x':
+                    m_pos++;
+                    c = Peek() == '{' ? ParseBracedNumber(16) : ParseNumber(16, 2);
+                    return EscapeKind::Char;
+                case 'u':
+                    m_pos++;
+                    if (!(m_options & PCRE2_ALT_BSUX)) {
+                        c = 'u';
+                    } else {
+                        c = Peek() == '{' ? ParseBracedNumber(16) : ParseNumber(16, 4);
+                    }
+                    return EscapeKind::Char;
+                case 'o':
+                    m_pos++;
+                    c = ParseBracedNumber(8);
+                    return EscapeKind::Char;
+                case 'c':
+                    m_pos++;
+                    c = AtEnd() ? 'c' : (NextCodePoint() & ~0x20u) ^ 0x40;
+                    return EscapeKind::Char;
+                case 'n':
+                    m_pos++;
+                    c = '\n';
+                    return EscapeKind::Char;
+                case 't':
+                    m_pos++;
+                    c = '\t';
+                    return EscapeKind::Char;
+                case 'r':
+                    m_pos++;
+                    c = '\r';
+                    return EscapeKind::Char;
+                case 'f':
+                    m_pos++;
+                    c = '\f';
+                    return EscapeKind::Char;
+                case 'e':
+                    m_pos++;
+                    c = 0x1b;
+                    return EscapeKind::Char;
+                case 'a':
+                    m_pos++;
+                    c = 0x07;
+                    return EscapeKind::Char;
+                case '0':
+                    c = ParseNumber(8, 3);
+                    return EscapeKind::Char;
+                default:
+                    if (e >= '1' && e <= '9') {
+                        if (inClass) {
+                            c = ParseNumber(8, 3);
+                            return EscapeKind::Char;
+                        }
+                        while (Peek() >= '0' && Peek() <= '9') {
+                            m_pos++;
+                        }
+                        return EscapeKind::Backreference;
+                    }
+
+                    c = NextCodePoint();
+                    return EscapeKind::Char;
+            }
+        }
+
+        static EscapeKind Negate(CharSet &set, bool negate) {
+            if (negate) {
+                set = set.Negated();
+            }
+            return EscapeKind::Set;
+        }
+
+        static void AddHorizontalSpace(CharSet &set) {
+            set.Add('\t', '\t');
+            set.Add(' ', ' ');
+            set.Add(0xa0, 0xa0);
+            set.Add(0x1680, 0x1680);
+            set.Add(0x180e, 0x180e);
+            set.Add(0x2000, 0x200a);
+            set.Add(0x202f, 0x202f);
+            set.Add(0x205f, 0x205f);
+            set.Add(0x3000, 0x3000);
+        }
+
+        static void AddVerticalSpace(CharSet &set) {
+            set.Add('\n', '\r');
+            set.Add(0x85, 0x85);
+            set.Add(0x2028, 0x2029);
+        }
+
+        uint32_t ParseNumber(uint32_t base, size_t maxDigits) {
+            uint32_t value = 0;
+            for (size_t i = 0; i < maxDigits && !AtEnd(); i++) {
+                int digit = DigitValue(Peek(), base);
+                if (digit < 0) {
+                    break;
+                }
+                value = value * base + digit;
+                m_pos++;
+            }
+            return std::min(value, kMaxCodePoint);
+        }
+
+        uint32_t ParseBracedNumber(uint32_t base) {
+            if (Peek() != '{') {
+                return 0;
+            }
+            m_pos++;
+            uint32_t value = ParseNumber(base, 8);
+            SkipTo('}');
+            return value;
+        }
+
+        static int DigitValue(char16_t c, uint32_t base) {
+            int value;
+            if (c >= '0' && c <= '9') {
+                value = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                value = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                value = c - 'A' + 10;
+            } else {
+                return -1;
+            }
+            return value < static_cast<int>(base) ? value : -1;
+        }
+
+        // Called after the opening bracket. Classes that can't be represented
+        // exactly, such as POSIX classes and set operations, are treated as
+        // matching anything.
+        CharSet ParseClass() {
+            bool negate = false;
+            if (Peek() == '^') {
+                negate = true;
+                m_pos++;
+            }
+
+            CharSet set;
+            bool unknown = false;
+            bool first = true;
+            while (!AtEnd()) {
+                char16_t c = Peek();
+                if (c == ']' && !first) {
+                    m_pos++;
+                    break;
+                }
+                first = false;
+
+                if (c == '[' && (Peek(1) == ':' || Peek(1) == '.' || Peek(1) == '=')) {
+                    char16_t delimiter = Peek(1);
+                    m_pos += 2;
+                    while (!AtEnd() && !(Peek() == delimiter && Peek(1) == ']')) {
+                        m_pos++;
+                    }
+                    m_pos += 2;
+                    unknown = true;
+                    continue;
+                }
+
+                if (m_options & PCRE2_ALT_EXTENDED_CLASS) {
+                    if (c == '[') {
+                        m_pos++;
+                        ParseClass();
+                        unknown = true;
+                        continue;
+                    }
+                    if ((c == '&' || c == '-' || c == '|' || c == '~') && Peek(1) == c) {
+                        m_pos += 2;
+                        unknown = true;
+                        continue;
+                    }
+                }
+
+                if (c == '\\' && Peek(1) == 'Q') {
+                    m_pos += 2;
+                    while (!AtEnd() && !(Peek() == '\\' && Peek(1) == 'E')) {
+                        uint32_t q = NextCodePoint();
+                        set.Add(q, q);
+                    }
+                    m_pos += 2;
+                    continue;
+                }
+
+                uint32_t lo;
+                if (!ParseClassChar(set, lo)) {
+                    continue;
+                }
+
+                if (Peek() == '-' && Peek(1) != ']' && m_pos + 1 < m_pattern.size()) {
+                    m_pos++;
+                    uint32_t hi;
+                    if (ParseClassChar(set, hi)) {
+                        set.Add(lo, hi);
+                    } else {
+                        set.Add(lo, lo);
+                        set.Add('-', '-');
+                    }
+                } else {
+                    set.Add(lo, lo);
+                }
+            }
+
+            if (m_caseless) {
+                set.AddCaseless();
+            }
+            if (negate) {
+                set = set.Negated();
+            }
+            return unknown ? CharSet::Any() : set;
+        }
+
+        // Returns whether a single character was parsed into c, escapes
+        // representing a set are added to set directly
+        bool ParseClassChar(CharSet &set, uint32_t &c) {
+            if (Peek() != '\\') {
+                c = NextCodePoint();
+                return true;
+            }
+
+            CharSet escapeSet;
+            switch (ParseEscape(true, c, escapeSet)) {
+                case EscapeKind::Char:
+                    return true;
+                case EscapeKind::Set:
+                    set.Add(escapeSet);
+                    return false;
+                default:
+                    return false;
+            }
+        }
+
+        const std::u16string &m_pattern;
+        uint32_t m_options;
+        size_t m_pos;
+        bool m_caseless;
+        bool m_extended;
+    };
+
+    // Whether two alternatives may match the same non-empty string
+    bool MayMatchSameString(const Node &a, const Node &b) {
+        if (a.fixed && b.fixed) {
+            if (a.shape.empty() || a.shape.size() != b.shape.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.shape.size(); i++) {
+                if (!a.shape[i].Overlaps(b.shape[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        return a.first.Overlaps(b.first);
+    }
+
+    // Finds a repeat with a variable count that node can match on its own,
+    // with everything around it matching the empty string. Repeating node
+    // then allows exponentially many ways to split the same subject.
+    const Node *FindSoleRepeat(const Node &node) {
+        switch (node.kind) {
+            case Node::Kind::Repeat:
+                if (node.possessive || node.max == 0) {
+                    return nullptr;
+                }
+                if (node.min < node.max && !node.children[0].all.Empty()) {
+                    return &node;
+                }
+                return FindSoleRepeat(node.children[0]);
+            case Node::Kind::Sequence: {
+                const Node *required = nullptr;
+                for (const Node &child : node.children) {
+                    if (!child.nullable) {
+                        if (required) {
+                            return nullptr;
+                        }
+                        required = &child;
+                    }
+                }
+                if (required) {
+                    return FindSoleRepeat(*required);
+                }
+                for (const Node &child : node.children) {
+                    if (const Node *found = FindSoleRepeat(child)) {
+                        return found;
+                    }
+                }
+                return nullptr;
+            }
+            case Node::Kind::Alternation:
+                for (const Node &child : node.children) {
+                    if (const Node *found = FindSoleRepeat(child)) {
+                        return found;
+                    }
+                }
+                return nullptr;
+            default:
+                return nullptr;
+        }
+    }
+
+    // Finds an alternation, that can be backtracked into, with two
+    // alternatives that may match the same string
+    const Node *FindOverlappingAlternation(const Node &node) {
+        switch (node.kind) {
+            case Node::Kind::Alternation:
+                for (size_t i = 0; i < node.children.size(); i++) {
+                    for (size_t j = i + 1; j < node.children.size(); j++) {
+                        if (MayMatchSameString(node.children[i], node.children[j])) {
+                            return &node;
+                        }
+                    }
+                }
+                [[fallthrough]];
+            case Node::Kind::Sequence:
+                for (const Node &child : node.children) {
+                    if (const Node *found = FindOverlappingAlternation(child)) {
+                        return found;
+                    }
+                }
+                return nullptr;
+            case Node::Kind::Repeat:
+                return node.possessive ? nullptr : FindOverlappingAlternation(node.children[0]);
+            default:
+                return nullptr;
+        }
+    }
+
+    void Visit(const Node &node, std::vector<PatternAnalysis::Issue> &issues) {
+        if (node.LargeRepeat()) {
+            const Node &body = node.children[0];
+            if (FindSoleRepeat(body)) {
+                issues.push_back({ PatternAnalysis::Risk::Exponential, "nestedQuantifier", node.start, node.end });
+            } else if (FindOverlappingAlternation(body)) {
+                issues.push_back({ PatternAnalysis::Risk::Exponential, "overlappingAlternation", node.start, node.end });
+            }
+        }
+
+        if (node.kind == Node::Kind::Sequence) {
+            // Two unbounded repeats that can consume the same characters,
+            // with nothing required in between, try every split point
+            for (size_t i = 0; i < node.children.size(); i++) {
+                const Node &a = node.children[i];
+                if (!a.LargeRepeat() || a.max != kUnbounded) {
+                    continue;
+                }
+                for (size_t j = i + 1; j < node.children.size(); j++) {
+                    const Node &b = node.children[j];
+                    if (b.LargeRepeat() && b.max == kUnbounded && a.all.Overlaps(b.all)) {
+                        issues.push_back({ PatternAnalysis::Risk::Polynomial, "adjacentQuantifiers", a.start, b.end });
+                        break;
+                    }
+                    if (!b.nullable) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (const Node &child : node.children) {
+            Visit(child, issues);
+        }
+    }
+}
+
+PatternAnalysis::PatternAnalysis(const std::u16string &pattern, uint32_t options)
+    : m_pattern(pattern)
+    , m_risk(Risk::None)
+{
+    Node root = Parser(m_pattern, options).Parse();
+    m_maxReach = root.reach;
+    Visit(root, m_issues);
+
+    std::stable_sort(m_issues.begin(), m_issues.end(), [](const Issue &a, const Issue &b) {
+        return a.start < b.start;
+    });
+    for (const Issue &issue : m_issues) {
+        m_risk = std::max(m_risk, issue.risk);
+    }
+}
+
+PatternAnalysis::Risk PatternAnalysis::GetRisk() const {
+    return m_risk;
+}
+
+const std::vector<PatternAnalysis::Issue> &PatternAnalysis::Issues() const {
+    return m_issues;
+}
+
+size_t PatternAnalysis::MaxReach() const {
+    return m_maxReach;
+}
+
+Napi::Object PatternAnalysis::ToObject(Napi::Env env) const {
+    Napi::Object result = Napi::Object::New(env);
+    result["risk"] = RiskName(m_risk);
+
+    Napi::Array issues = Napi::Array::New(env, m_issues.size());
+    for (size_t i = 0; i < m_issues.size(); i++) {
+        const Issue &issue = m_issues[i];
+        Napi::Object item = Napi::Object::New(env);
+        item["risk"] = RiskName(issue.risk);
+        item["kind"] = issue.kind;
+        item["start"] = static_cast<double>(issue.start);
+        item["end"] = static_cast<double>(issue.end);
+        item["source"] = Napi::String::New(env, m_pattern.substr(issue.start, issue.end - issue.start));
+        issues[i] = item;
+    }
+    result["issues"] = issues;
+
+    return result;
+}
+
+const char *PatternAnalysis::RiskName(Risk risk) {
+    switch (risk) {
+        case Risk::Polynomial:
+            return "polynomial";
+        case Risk::Exponential:
+            return "exponential";
+        case Risk::None:
+        default:
+            return "none";
+    }
+}
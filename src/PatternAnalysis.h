@@ -0,0 +1,50 @@
+#ifndef NODE_PCRE2_PATTERN_ANALYSIS_H_
+#define NODE_PCRE2_PATTERN_ANALYSIS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <napi.h>
+
+// Static analysis of a pattern for constructs that may backtrack
+// catastrophically. PCRE2 doesn't expose its compiled code, so this works on
+// the pattern source, which PCRE2 must have already accepted. The analysis
+// is a heuristic: it may report constructs that are only ambiguous in theory,
+// and doesn't look through backreferences or recursion.
+class PatternAnalysis {
+public:
+    enum class Risk {
+        None,
+        Polynomial,
+        Exponential,
+    };
+
+    struct Issue {
+        Risk risk;
+        const char *kind;
+        // Span in the pattern, in UTF-16 code units
+        size_t start;
+        size_t end;
+    };
+
+    PatternAnalysis(const std::u16string &pattern, uint32_t options);
+
+    Risk GetRisk() const;
+    const std::vector<Issue> &Issues() const;
+    // How many code units past its start a match attempt may look at, not
+    // counting assertions that peek at a single character, or SIZE_MAX when
+    // unbounded or unknown
+    size_t MaxReach() const;
+
+    Napi::Object ToObject(Napi::Env env) const;
+
+    static const char *RiskName(Risk risk);
+
+private:
+    std::u16string m_pattern;
+    Risk m_risk;
+    std::vector<Issue> m_issues;
+    size_t m_maxReach;
+};
+
+#endif // NODE_PCRE2_PATTERN_ANALYSIS_H_
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "PatternProfiler.h"
+
+PatternProfiler::PatternProfiler(pcre2_code *code, pcre2_general_context *generalContext, uint32_t matchLimit)
+    : m_code(code)
+    , m_calls(0)
+    , m_attempts(0)
+{
+    m_matchContext = pcre2_match_context_create(generalContext);
+    pcre2_set_callout(m_matchContext, Callout, this);
+    if (matchLimit != 0) {
+        pcre2_set_match_limit(m_matchContext, matchLimit);
+    }
+}
+
+PatternProfiler::~PatternProfiler() {
+    pcre2_match_context_free(m_matchContext);
+    pcre2_code_free(m_code);
+}
+
+pcre2_code *PatternProfiler::Code() const {
+    return m_code;
+}
+
+pcre2_match_context *PatternProfiler::MatchContext() const {
+    return m_matchContext;
+}
+
+void PatternProfiler::AddCall() {
+    m_calls++;
+}
+
+int PatternProfiler::Callout(pcre2_callout_block *block, void *data) {
+    PatternProfiler *profiler = static_cast<PatternProfiler*>(data);
+
+    // The callout flags are only set by the interpreter, which is why the
+    // profiled copy is never JIT compiled
+    if (block->callout_flags & PCRE2_CALLOUT_STARTMATCH) {
+        profiler->m_attempts++;
+    }
+
+    ItemCounts &item = profiler->m_items[block->pattern_position];
+    item.length = block->next_item_length;
+    item.visits++;
+    if (block->callout_flags & PCRE2_CALLOUT_BACKTRACK) {
+        item.backtracks++;
+    }
+
+    return 0;
+}
+
+Napi::Object PatternProfiler::Report(Napi::Env env, const std::u16string &pattern) const {
+    Napi::Object result = Napi::Object::New(env);
+    result["calls"] = static_cast<double>(m_calls);
+    result["attempts"] = static_cast<double>(m_attempts);
+
+    Napi::Array items = Napi::Array::New(env, m_items.size());
+    uint32_t i = 0;
+    for (const auto &entry : m_items) {
+        size_t offset = std::min(entry.first, pattern.size());
+        size_t length = std::min(entry.second.length, pattern.size() - offset);
+
+        Napi::Object item = Napi::Object::New(env);
+        item["offset"] = entry.first;
+        item["length"] = entry.second.length;
+        item["item"] = Napi::String::New(env, pattern.c_str() + offset, length);
+        item["visits"] = static_cast<double>(entry.second.visits);
+        item["backtracks"] = static_cast<double>(entry.second.backtracks);
+        items[i++] = item;
+    }
+    result["items"] = items;
+
+    return result;
+}
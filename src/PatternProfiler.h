@@ -0,0 +1,45 @@
+#ifndef NODE_PCRE2_PATTERN_PROFILER_H_
+#define NODE_PCRE2_PATTERN_PROFILER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <napi.h>
+#include <pcre2.h>
+
+// Profiles matching using a copy of the pattern compiled with
+// PCRE2_AUTO_CALLOUT, counting how many times each item of the pattern is
+// visited, and how many times matching backtracked into it.
+class PatternProfiler {
+public:
+    // Takes ownership of code, which must be compiled with PCRE2_AUTO_CALLOUT.
+    // A matchLimit of 0 keeps PCRE2's default.
+    PatternProfiler(pcre2_code *code, pcre2_general_context *generalContext, uint32_t matchLimit);
+    ~PatternProfiler();
+
+    PatternProfiler(const PatternProfiler&) = delete;
+    PatternProfiler& operator=(const PatternProfiler&) = delete;
+
+    pcre2_code *Code() const;
+    pcre2_match_context *MatchContext() const;
+
+    void AddCall();
+    Napi::Object Report(Napi::Env env, const std::u16string &pattern) const;
+
+private:
+    struct ItemCounts {
+        size_t length;
+        uint64_t visits;
+        uint64_t backtracks;
+    };
+
+    static int Callout(pcre2_callout_block *block, void *data);
+
+    pcre2_code *m_code;
+    pcre2_match_context *m_matchContext;
+    uint64_t m_calls;
+    uint64_t m_attempts;
+    std::map<size_t, ItemCounts> m_items;
+};
+
+#endif // NODE_PCRE2_PATTERN_PROFILER_H_
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "InstanceData.h"
+#include "PatternStats.h"
+
+PatternStats::PatternStats(InstanceData *instanceData, const std::u16string &pattern, const std::string &flags, uint32_t sampleInterval)
+    : m_instanceData(instanceData)
+    , m_pattern(pattern)
+    , m_flags(flags)
+    , m_sampleInterval(sampleInterval)
+    , m_untilSample(0)
+    , m_calls(0)
+    , m_matches(0)
+    , m_noMatches(0)
+    , m_errors(0)
+    , m_sampledCalls(0)
+    , m_sampledTimeNs(0)
+    , m_maxTimeNs(0)
+    , m_bytesScanned(0)
+    , m_jitSize(0)
+    , m_heapFramesHighWater(0)
+{
+    m_instanceData->patternStats.insert(this);
+}
+
+PatternStats::~PatternStats() {
+    m_instanceData->patternStats.erase(this);
+}
+
+bool PatternStats::StartCall(std::chrono::steady_clock::time_point &start) {
+    if (m_untilSample-- > 0) {
+        return false;
+    }
+
+    m_untilSample = m_sampleInterval - 1;
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void PatternStats::EndCall(int rc, size_t subjectLength, bool timed, std::chrono::steady_clock::time_point start) {
+    if (timed) {
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        m_sampledCalls++;
+        m_sampledTimeNs += elapsed;
+        m_maxTimeNs = std::max(m_maxTimeNs, elapsed);
+    }
+
+    m_calls++;
+    m_bytesScanned += subjectLength * sizeof(char16_t);
+    // rc is the number of substitutions for pcre2_substitute
+    if (rc > 0) {
+        m_matches++;
+    } else if (rc == 0 || rc == PCRE2_ERROR_NOMATCH) {
+        m_noMatches++;
+    } else {
+        m_errors++;
+    }
+}
+
+void PatternStats::SetJitSize(size_t jitSize) {
+    m_jitSize = jitSize;
+}
+
+void PatternStats::SetHeapFramesSize(size_t heapFramesSize) {
+    m_heapFramesHighWater = std::max(m_heapFramesHighWater, heapFramesSize);
+}
+
+Napi::Object PatternStats::ToObject(Napi::Env env) const {
+    Napi::Object result = Napi::Object::New(env);
+    result["source"] = Napi::String::New(env, m_pattern);
+    result["flags"] = Napi::String::New(env, m_flags);
+    result["calls"] = static_cast<double>(m_calls);
+    result["matches"] = static_cast<double>(m_matches);
+    result["noMatches"] = static_cast<double>(m_noMatches);
+    result["errors"] = static_cast<double>(m_errors);
+    result["sampledCalls"] = static_cast<double>(m_sampledCalls);
+    result["sampledTime"] = m_sampledTimeNs / 1e6;
+    result["estimatedTotalTime"] = m_sampledCalls > 0
+        ? (m_sampledTimeNs / 1e6) * (static_cast<double>(m_calls) / m_sampledCalls)
+        : 0.0;
+    result["maxTime"] = m_maxTimeNs / 1e6;
+    result["bytesScanned"] = static_cast<double>(m_bytesScanned);
+    result["jit"] = Napi::Boolean::New(env, m_jitSize != 0);
+    result["jitSize"] = m_jitSize;
+    result["heapFramesHighWater"] = m_heapFramesHighWater;
+    return result;
+}
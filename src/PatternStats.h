@@ -0,0 +1,47 @@
+#ifndef NODE_PCRE2_PATTERN_STATS_H_
+#define NODE_PCRE2_PATTERN_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <napi.h>
+
+class InstanceData;
+
+// Runtime statistics of a pattern. Counters are updated on every call, while
+// only one in every sampleInterval calls is timed to keep the overhead low.
+class PatternStats {
+public:
+    PatternStats(InstanceData *instanceData, const std::u16string &pattern, const std::string &flags, uint32_t sampleInterval);
+    ~PatternStats();
+
+    PatternStats(const PatternStats&) = delete;
+    PatternStats& operator=(const PatternStats&) = delete;
+
+    // Returns whether this call should be timed, in which case start is set
+    bool StartCall(std::chrono::steady_clock::time_point &start);
+    void EndCall(int rc, size_t subjectLength, bool timed, std::chrono::steady_clock::time_point start);
+    void SetJitSize(size_t jitSize);
+    void SetHeapFramesSize(size_t heapFramesSize);
+
+    Napi::Object ToObject(Napi::Env env) const;
+
+private:
+    InstanceData *m_instanceData;
+    std::u16string m_pattern;
+    std::string m_flags;
+    uint32_t m_sampleInterval;
+    uint32_t m_untilSample;
+    uint64_t m_calls;
+    uint64_t m_matches;
+    uint64_t m_noMatches;
+    uint64_t m_errors;
+    uint64_t m_sampledCalls;
+    uint64_t m_sampledTimeNs;
+    uint64_t m_maxTimeNs;
+    uint64_t m_bytesScanned;
+    size_t m_jitSize;
+    size_t m_heapFramesHighWater;
+};
+
+#endif // NODE_PCRE2_PATTERN_STATS_H_
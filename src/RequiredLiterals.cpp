@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <pcre2.h>
+#include "RequiredLiterals.h"
+
+namespace {
+    const uint32_t kUnbounded = UINT32_MAX;
+    // Counted repeats longer than this are not expanded into the literal
+    const uint32_t kMaxExpandedRepeat = 8;
+
+    // Literals at least one of which is in every match. An empty set means
+    // nothing is known.
+    struct LiteralSet {
+        std::vector<std::u16string> literals;
+
+        // A set is as selective as its shortest literal
+        size_t Shortest() const {
+            size_t shortest = SIZE_MAX;
+            for (const std::u16string &literal : literals) {
+                shortest = std::min(shortest, literal.size());
+            }
+            return shortest;
+        }
+
+        bool BetterThan(const LiteralSet &other) const {
+            if (literals.empty() || other.literals.empty()) {
+                return other.literals.empty() && !literals.empty();
+            }
+            if (Shortest() != other.Shortest()) {
+                return Shortest() > other.Shortest();
+            }
+            return literals.size() < other.literals.size();
+        }
+    };
+
+    class Parser {
+    public:
+        Parser(const std::u16string &pattern, uint32_t options)
+            : m_pattern(pattern)
+            , m_pos(0)
+            , m_failed((options & (PCRE2_EXTENDED | PCRE2_EXTENDED_MORE | PCRE2_LITERAL)) != 0)
+            , m_caseless((options & PCRE2_CASELESS) != 0)
+            , m_utf((options & PCRE2_UTF) != 0)
+            , m_unicode((options & (PCRE2_UTF | PCRE2_UCP)) != 0)
+        {
+        }
+
+        LiteralSet Parse() {
+            LiteralSet result = ParseAlternation();
+            if (m_failed || !AtEnd()) {
+                return LiteralSet();
+            }
+            return result;
+        }
+
+    private:
+        enum class ItemKind {
+            Literal,
+            Other,
+            ZeroWidth,
+        };
+
+        bool AtEnd() const {
+            return m_pos >= m_pattern.size();
+        }
+
+        char16_t Peek(size_t offset = 0) const {
+            return m_pos + offset < m_pattern.size() ? m_pattern[m_pos + offset] : 0;
+        }
+
+        static bool IsDigit(char16_t c) {
+            return c >= '0' && c <= '9';
+        }
+
+        static int HexValue(char16_t c) {
+            if (IsDigit(c)) {
+                return c - '0';
+            }
+            if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                return (c | 0x20) - 'a' + 10;
+            }
+            return -1;
+        }
+
+        // Whether a matched character is certain to be c, up to ASCII case
+        bool Usable(const std::u16string &literal) const {
+            if (!m_caseless) {
+                return true;
+            }
+            char16_t c = literal[0];
+            // Caseless Unicode matching folds K and S with the Kelvin and
+            // long s signs
+            char16_t lower = c | 0x20;
+            return c < 0x80 && !(m_unicode && (lower == 'k' || lower == 's'));
+        }
+
+        LiteralSet ParseAlternation() {
+            LiteralSet result;
+            bool complete = true;
+            while (true) {
+                LiteralSet sequence = ParseSequence();
+                if (sequence.literals.empty()) {
+                    complete = false;
+                }
+                result.literals.insert(result.literals.end(), sequence.literals.begin(), sequence.literals.end());
+
+                if (m_failed || Peek() != '|') {
+                    break;
+                }
+                m_pos++;
+            }
+
+            if (!complete) {
+                return LiteralSet();
+            }
+
+            // A literal containing another one adds nothing
+            std::vector<std::u16string> &literals = result.literals;
+            std::sort(literals.begin(), literals.end(), [](const std::u16string &a, const std::u16string &b) {
+                return a.size() < b.size() || (a.size() == b.size() && a < b);
+            });
+            literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+            for (size_t i = 0; i < literals.size(); i++) {
+                literals.erase(std::remove_if(literals.begin() + i + 1, literals.end(), [&](const std::u16string &literal) {
+                    return literal.find(literals[i]) != std::u16string::npos;
+                }), literals.end());
+            }
+            return result;
+        }
+
+        LiteralSet ParseSequence() {
+            LiteralSet best;
+            std::u16string run;
+
+            auto consider = [&best](LiteralSet set) {
+                if (set.BetterThan(best)) {
+                    best = std::move(set);
+                }
+            };
+            auto endRun = [&run, &consider]() {
+                if (!run.empty()) {
+                    consider(LiteralSet{ { run } });
+                    run.clear();
+                }
+            };
+
+            while (!m_failed && !AtEnd() && Peek() != '|' && Peek() != ')') {
+                std::u16string literal;
+                LiteralSet group;
+                ItemKind kind = ParseItem(literal, group);
+                if (m_failed) {
+                    break;
+                }
+
+                uint32_t min = 1;
+                uint32_t max = 1;
+                bool quantified = ParseQuantifier(min, max);
+
+                // Assertions don't consume anything, so the characters either
+                // side of them are still adjacent
+                if (kind == ItemKind::ZeroWidth) {
+                    continue;
+                }
+
+                if (kind != ItemKind::Literal || !Usable(literal)) {
+                    endRun();
+                    if (min > 0) {
+                        consider(std::move(group));
+                    }
+                    continue;
+                }
+
+                if (!quantified) {
+                    run += literal;
+                } else if (min == max && min <= kMaxExpandedRepeat) {
+                    for (uint32_t i = 0; i < min; i++) {
+                        run += literal;
+                    }
+                } else if (min == 0) {
+                    endRun();
+                } else {
+                    // The run ends with the first repetitions, and the next
+                    // one starts with the last
+                    for (uint32_t i = 0; i < std::min(min, kMaxExpandedRepeat); i++) {
+                        run += literal;
+                    }
+                    endRun();
+                    run += literal;
+                }
+            }
+
+            endRun();
+            return best;
+        }
+
+        ItemKind ParseItem(std::u16string &literal, LiteralSet &group) {
+            char16_t c = m_pattern[m_pos++];
+            switch (c) {
+                case '\\':
+                    return ParseEscape(literal);
+                case '[':
+                    SkipClass();
+                    return ItemKind::Other;
+                case '(':
+                    return ParseGroup(group);
+                case '.':
+                    return ItemKind::Other;
+                case '^':
+                case '$':
+                    return ItemKind::ZeroWidth;
+                case '*':
+                case '+':
+                case '?':
+                    // Can't start an item, compilation would have failed
+                    m_failed = true;
+                    return ItemKind::Other;
+                default:
+                    literal = c;
+                    // A quantifier applies to the whole surrogate pair
+                    if (m_utf && c >= 0xd800 && c <= 0xdbff && Peek() >= 0xdc00 && Peek() <= 0xdfff) {
+                        literal += m_pattern[m_pos++];
+                    }
+                    return ItemKind::Literal;
+            }
+        }
+
+        ItemKind ParseEscape(std::u16string &literal) {
+            if (AtEnd()) {
+                m_failed = true;
+                return ItemKind::Other;
+            }
+
+            char16_t c = m_pattern[m_pos++];
+            switch (c) {
+                case 'n': literal = u"\n"; return ItemKind::Literal;
+                case 'r': literal = u"\r"; return ItemKind::Literal;
+                case 't': literal = u"\t"; return ItemKind::Literal;
+                case 'f': literal = u"\f"; return ItemKind::Literal;
+                case 'a': literal = u"\a"; return ItemKind::Literal;
+                case 'e': literal = u"\x1b"; return ItemKind::Literal;
+                case 'x': {
+                    int hi = HexValue(Peek());
+                    int lo = HexValue(Peek(1));
+                    if (hi < 0 || lo < 0) {
+                        m_failed = true;
+                        return ItemKind::Other;
+                    }
+                    m_pos += 2;
+                    literal = static_cast<char16_t>(hi * 16 + lo);
+                    return ItemKind::Literal;
+                }
+                case 'b': case 'B': case 'A': case 'z': case 'Z': case 'G': case 'K':
+                    return ItemKind::ZeroWidth;
+                case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+                case 'N': {
+                    // \N{U+hh} names a character, while \N{n} repeats \N
+                    uint32_t min, max;
+                    size_t pos = m_pos;
+                    if (Peek() == '{' && !ParseBraces(min, max)) {
+                        SkipTo('}');
+                    } else {
+                        m_pos = pos;
+                    }
+                    return ItemKind::Other;
+                }
+                case 'h': case 'H': case 'v': case 'V': case 'R':
+                case 'X': case 'C':
+                    return ItemKind::Other;
+                case 'p': case 'P':
+                    if (Peek() == '{') {
+                        SkipTo('}');
+                    } else {
+                        m_pos++;
+                    }
+                    return ItemKind::Other;
+                default:
+                    // Backreferences, octal and \u escapes and anything else
+                    // with a special meaning
+                    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c)) {
+                        m_failed = true;
+                        return ItemKind::Other;
+                    }
+                    literal = c;
+                    return ItemKind::Literal;
+            }
+        }
+
+        ItemKind ParseGroup(LiteralSet &group) {
+            bool lookaround = false;
+
+            if (Peek() == '*') {
+                m_failed = true;
+                return ItemKind::Other;
+            }
+
+            if (Peek() == '?') {
+                m_pos++;
+                char16_t c = Peek();
+                if (c == '#') {
+                    SkipTo(')');
+                    return ItemKind::ZeroWidth;
+                } else if (c == ':' || c == '>' || c == '|') {
+                    m_pos++;
+                } else if (c == '=' || c == '!') {
+                    m_pos++;
+                    lookaround = true;
+                } else if (c == '<' && (Peek(1) == '=' || Peek(1) == '!')) {
+                    m_pos += 2;
+                    lookaround = true;
+                } else if (c == '<' || c == '\'') {
+                    SkipTo(c == '<' ? '>' : '\'');
+                } else if (c == 'P' && Peek(1) == '<') {
+                    SkipTo('>');
+                } else {
+                    // Inline options, conditionals, recursion and callouts
+                    m_failed = true;
+                    return ItemKind::Other;
+                }
+            }
+
+            LiteralSet inner = ParseAlternation();
+            if (m_failed || Peek() != ')') {
+                m_failed = true;
+                return ItemKind::Other;
+            }
+            m_pos++;
+
+            if (lookaround) {
+                return ItemKind::ZeroWidth;
+            }
+
+            group = std::move(inner);
+            return ItemKind::Other;
+        }
+
+        bool ParseQuantifier(uint32_t &min, uint32_t &max) {
+            switch (Peek()) {
+                case '*': min = 0; max = kUnbounded; m_pos++; break;
+                case '+': min = 1; max = kUnbounded; m_pos++; break;
+                case '?': min = 0; max = 1; m_pos++; break;
+                case '{':
+                    if (!ParseBraces(min, max)) {
+                        return false;
+                    }
+                    break;
+                default:
+                    return false;
+            }
+
+            // Lazy or possessive
+            if (Peek() == '?' || Peek() == '+') {
+                m_pos++;
+            }
+            return true;
+        }
+
+        // {n}, {n,}, {n,m} or {,m}, with optional spaces around the numbers,
+        // anything else is a literal brace
+        bool ParseBraces(uint32_t &min, uint32_t &max) {
+            size_t pos = m_pos + 1;
+            auto skipSpaces = [this, &pos]() {
+                while (pos < m_pattern.size() && (m_pattern[pos] == ' ' || m_pattern[pos] == '\t')) {
+                    pos++;
+                }
+            };
+            auto number = [this, &pos](uint32_t &value) {
+                size_t start = pos;
+                value = 0;
+                while (pos < m_pattern.size() && IsDigit(m_pattern[pos])) {
+                    value = std::min<uint32_t>(value * 10 + (m_pattern[pos] - '0'), 65535);
+                    pos++;
+                }
+                return pos > start;
+            };
+
+            skipSpaces();
+            bool hasMin = number(min);
+            skipSpaces();
+            if (pos < m_pattern.size() && m_pattern[pos] == ',') {
+                pos++;
+                skipSpaces();
+                if (!number(max)) {
+                    max = kUnbounded;
+                } else if (!hasMin) {
+                    min = 0;
+                }
+                if (!hasMin && max == kUnbounded) {
+                    return false;
+                }
+                skipSpaces();
+            } else if (hasMin) {
+                max = min;
+            } else {
+                return false;
+            }
+
+            if (pos >= m_pattern.size() || m_pattern[pos] != '}') {
+                return false;
+            }
+            m_pos = pos + 1;
+            return true;
+        }
+
+        void SkipClass() {
+            if (Peek() == '^') {
+                m_pos++;
+            }
+            // A leading ] is part of the class
+            if (Peek() == ']') {
+                m_pos++;
+            }
+
+            while (!AtEnd()) {
+                char16_t c = m_pattern[m_pos++];
+                if (c == ']') {
+                    return;
+                } else if (c == '\\') {
+                    m_pos++;
+                } else if (c == '[' && (Peek() == ':' || Peek() == '.' || Peek() == '=')) {
+                    char16_t delimiter = Peek();
+                    m_pos++;
+                    while (!AtEnd() && !(m_pattern[m_pos] == delimiter && Peek(1) == ']')) {
+                        m_pos++;
+                    }
+                    m_pos += 2;
+                } else if (c == '[') {
+                    // Nested classes of the v flag
+                    m_failed = true;
+                    return;
+                }
+            }
+
+            m_failed = true;
+        }
+
+        void SkipTo(char16_t c) {
+            while (!AtEnd() && m_pattern[m_pos] != c) {
+                m_pos++;
+            }
+            if (!AtEnd()) {
+                m_pos++;
+            }
+        }
+
+        const std::u16string &m_pattern;
+        size_t m_pos;
+        bool m_failed;
+        bool m_caseless;
+        bool m_utf;
+        bool m_unicode;
+    };
+}
+
+RequiredLiterals::RequiredLiterals(const std::u16string &pattern, uint32_t options) {
+    m_literals = Parser(pattern, options).Parse().literals;
+}
+
+const std::vector<std::u16string> &RequiredLiterals::Literals() const {
+    return m_literals;
+}
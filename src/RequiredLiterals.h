@@ -0,0 +1,26 @@
+#ifndef NODE_PCRE2_REQUIRED_LITERALS_H_
+#define NODE_PCRE2_REQUIRED_LITERALS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finds literals at least one of which must appear in any match of a
+// pattern, so that subjects which contain none of them can be rejected
+// without matching. Works on the pattern source like PatternAnalysis, and
+// gives up (finding nothing) on syntax it doesn't follow, such as inline
+// option settings, conditionals or extended mode. Letters are reported as
+// written, they are only required up to ASCII case when the pattern is
+// caseless; literals are cut at letters that could match non-ASCII
+// characters.
+class RequiredLiterals {
+public:
+    RequiredLiterals(const std::u16string &pattern, uint32_t options);
+
+    const std::vector<std::u16string> &Literals() const;
+
+private:
+    std::vector<std::u16string> m_literals;
+};
+
+#endif // NODE_PCRE2_REQUIRED_LITERALS_H_
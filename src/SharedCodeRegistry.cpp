@@ -0,0 +1,49 @@
+#include "SharedCodeRegistry.h"
+
+std::mutex SharedCodeRegistry::s_mutex;
+uint64_t SharedCodeRegistry::s_nextId = 1;
+std::unordered_map<uint64_t, SharedCodeRegistry::Entry> SharedCodeRegistry::s_entries;
+std::unordered_map<const pcre2_code*, uint64_t> SharedCodeRegistry::s_ids;
+
+uint64_t SharedCodeRegistry::Share(const SharedCode &shared) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto id = s_ids.find(shared.code.get());
+    if (id != s_ids.end()) {
+        s_entries[id->second].pins++;
+        return id->second;
+    }
+
+    uint64_t newId = s_nextId++;
+    s_entries.emplace(newId, Entry{shared, 1});
+    s_ids.emplace(shared.code.get(), newId);
+    return newId;
+}
+
+bool SharedCodeRegistry::Lookup(uint64_t id, SharedCode &shared) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto entry = s_entries.find(id);
+    if (entry == s_entries.end()) {
+        return false;
+    }
+
+    shared = entry->second.shared;
+    return true;
+}
+
+bool SharedCodeRegistry::Release(uint64_t id) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto entry = s_entries.find(id);
+    if (entry == s_entries.end()) {
+        return false;
+    }
+
+    if (--entry->second.pins == 0) {
+        s_ids.erase(entry->second.shared.code.get());
+        s_entries.erase(entry);
+    }
+
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef NODE_PCRE2_SHARED_CODE_REGISTRY_H_
+#define NODE_PCRE2_SHARED_CODE_REGISTRY_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <pcre2.h>
+
+// A compiled pattern, along with what is needed to construct a PCRE2 over it
+struct SharedCode {
+    std::shared_ptr<pcre2_code> code;
+    std::u16string pattern;
+    std::string flags;
+};
+
+// Process wide registry of compiled patterns shared between environments
+// (e.g. worker threads). Each call to Share pins the code until a matching
+// call to Release, PCRE2 instances constructed over it keep it alive on their
+// own.
+class SharedCodeRegistry {
+public:
+    static uint64_t Share(const SharedCode &shared);
+    static bool Lookup(uint64_t id, SharedCode &shared);
+    static bool Release(uint64_t id);
+
+private:
+    struct Entry {
+        SharedCode shared;
+        size_t pins;
+    };
+
+    static std::mutex s_mutex;
+    static uint64_t s_nextId;
+    static std::unordered_map<uint64_t, Entry> s_entries;
+    static std::unordered_map<const pcre2_code*, uint64_t> s_ids;
+};
+
+#endif // NODE_PCRE2_SHARED_CODE_REGISTRY_H_
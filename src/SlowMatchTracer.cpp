@@ -0,0 +1,52 @@
+#include "SlowMatchTracer.h"
+
+SlowMatchTracer::SlowMatchTracer()
+    : m_thresholdMs(0)
+    , m_subscribed(false)
+{
+}
+
+void SlowMatchTracer::SetThreshold(double thresholdMs) {
+    m_thresholdMs = thresholdMs > 0 ? thresholdMs : 0;
+}
+
+double SlowMatchTracer::Threshold() const {
+    return m_thresholdMs;
+}
+
+void SlowMatchTracer::SetPublisher(Napi::Function publisher) {
+    m_publisher = Napi::Persistent(publisher);
+}
+
+void SlowMatchTracer::SetSubscribed(bool subscribed) {
+    m_subscribed = subscribed;
+}
+
+bool SlowMatchTracer::StartCall(std::chrono::steady_clock::time_point &start) const {
+    if (m_thresholdMs == 0 || !m_subscribed) {
+        return false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void SlowMatchTracer::EndCall(Napi::Env env, std::chrono::steady_clock::time_point start, const Call &call) {
+    double durationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (durationMs < m_thresholdMs || m_publisher.IsEmpty()) {
+        return;
+    }
+
+    // The subject itself is never published, it may hold sensitive data
+    Napi::HandleScope scope(env);
+    Napi::Object event = Napi::Object::New(env);
+    event["kind"] = call.kind;
+    event["source"] = Napi::String::New(env, call.pattern);
+    event["flags"] = call.flags;
+    event["subjectLength"] = call.subjectLength;
+    event["lastIndex"] = call.lastIndex;
+    event["durationMs"] = durationMs;
+    event["jit"] = call.jit;
+    event["returnCode"] = call.rc;
+    m_publisher.Call({ event });
+}
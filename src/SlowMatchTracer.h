@@ -0,0 +1,46 @@
+#ifndef NODE_PCRE2_SLOW_MATCH_TRACER_H_
+#define NODE_PCRE2_SLOW_MATCH_TRACER_H_
+
+#include <chrono>
+#include <string>
+#include <napi.h>
+
+// Times every matching call while a threshold is set and the
+// pcre2:slow-match diagnostics channel has subscribers, and hands the calls
+// that take longer to a publisher function. The JS wrapper sets a publisher
+// that publishes them on the channel, and keeps the subscribed flag in sync
+// with it. Otherwise nothing is timed.
+class SlowMatchTracer {
+public:
+    struct Call {
+        // "match" or "substitute"
+        const char *kind;
+        const std::u16string &pattern;
+        const std::string &flags;
+        size_t subjectLength;
+        size_t lastIndex;
+        bool jit;
+        int rc;
+    };
+
+    SlowMatchTracer();
+
+    SlowMatchTracer(const SlowMatchTracer&) = delete;
+    SlowMatchTracer& operator=(const SlowMatchTracer&) = delete;
+
+    void SetThreshold(double thresholdMs);
+    double Threshold() const;
+    void SetPublisher(Napi::Function publisher);
+    void SetSubscribed(bool subscribed);
+
+    // Returns whether this call should be timed, in which case start is set
+    bool StartCall(std::chrono::steady_clock::time_point &start) const;
+    void EndCall(Napi::Env env, std::chrono::steady_clock::time_point start, const Call &call);
+
+private:
+    double m_thresholdMs;
+    bool m_subscribed;
+    Napi::FunctionReference m_publisher;
+};
+
+#endif // NODE_PCRE2_SLOW_MATCH_TRACER_H_
@@ -1,5 +1,13 @@
+import { channel, subscribe, unsubscribe } from "node:diagnostics_channel";
+import { once } from "node:events";
+import { readFileSync, rmSync } from "node:fs";
+import { createRequire } from "node:module";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { Worker } from "node:worker_threads";
 import { describe, test, vi } from "vitest";
-import { PCRE2, pcre2 } from "..";
+import { PCRE2, PCRE2Document, PCRE2Lexer, PCRE2RuleIndex, pcre2 } from "..";
+import { readTrace } from "../bench/trace.mts";
 
 function createMatchArray(
   matches: string[],
@@ -524,3 +532,1071 @@ describe.concurrent("replace", () => {
     );
   });
 });
+
+describe.concurrent("filterParallel", () => {
+  test("returns matching indices", async ({ expect }) => {
+    const re = pcre2`ab+c`;
+    const strings = ["abc", "foo", "xabbbcx", "", "ac", "abc"];
+    const result = await re.filterParallel(strings, { threads: 3 });
+    expect(result).toBeInstanceOf(Uint32Array);
+    expect([...result]).toStrictEqual([0, 2, 5]);
+  });
+
+  test("empty array", async ({ expect }) => {
+    const re = pcre2`abc`;
+    const result = await re.filterParallel([]);
+    expect([...result]).toStrictEqual([]);
+  });
+
+  test("more threads than strings", async ({ expect }) => {
+    const re = pcre2`abc`;
+    const result = await re.filterParallel(["abc", "abd"], { threads: 16 });
+    expect([...result]).toStrictEqual([0]);
+  });
+
+  test("sticky is anchored and lastIndex is untouched", async ({ expect }) => {
+    const re = pcre2("gy")`abc`;
+    re.lastIndex = 2;
+    const result = await re.filterParallel(["abc", "xabc"]);
+    expect([...result]).toStrictEqual([0]);
+    expect(re.lastIndex).toBe(2);
+  });
+
+  test("matches RegExp on a large input", async ({ expect }) => {
+    const re = pcre2`\d{3}-\d{4}`;
+    const strings = Array.from({ length: 10000 }, (_, i) =>
+      i % 7 === 0 ? `call ${String(i).padStart(3, "0")}-1234` : `line ${i}`
+    );
+    const expected = strings.flatMap((s, i) =>
+      /\d{3}-\d{4}/.test(s) ? [i] : []
+    );
+    const result = await re.filterParallel(strings, { threads: 4 });
+    expect([...result]).toStrictEqual(expected);
+  });
+
+  test("rejects invalid arguments", ({ expect }) => {
+    const re = pcre2`abc`;
+    // @ts-expect-error Invalid argument
+    expect(() => re.filterParallel("abc")).toThrow("Expected an array of strings");
+    for (const threads of [0, -1, 1.5, NaN]) {
+      expect(() => re.filterParallel(["abc"], { threads })).toThrow(RangeError);
+    }
+  });
+});
+
+describe.concurrent("share", () => {
+  test("fromShared in the same thread", ({ expect }) => {
+    const re = pcre2("gi")`a(b+)c`;
+    const id = re.share();
+    expect(re.share()).toBe(id);
+
+    const shared = PCRE2.fromShared(id);
+    expect(shared.source).toBe("a(b+)c");
+    expect(shared.flags).toBe("gi");
+    expect("xABBcabc".match(shared)).toStrictEqual(["ABBc", "abc"]);
+
+    expect(PCRE2.releaseShared(id)).toBe(true);
+    expect(PCRE2.releaseShared(id)).toBe(true);
+    expect(PCRE2.releaseShared(id)).toBe(false);
+    expect(() => PCRE2.fromShared(id)).toThrow(`Unknown shared PCRE2 id ${id}`);
+    expect("abbc".match(shared)).toStrictEqual(["abbc"]);
+  });
+
+  test("fromShared in a worker thread", async ({ expect }) => {
+    const require = createRequire(import.meta.url);
+    const id = pcre2("g")`a(b+)c`.share();
+    const worker = new Worker(
+      `
+      const { parentPort, workerData } = require("node:worker_threads");
+      const { PCRE2 } = require(workerData.module);
+      const re = PCRE2.fromShared(workerData.id);
+      parentPort.postMessage({
+        source: re.source,
+        flags: re.flags,
+        matches: "xabbcabc".match(re),
+      });
+      `,
+      { eval: true, workerData: { id, module: require.resolve("..") } }
+    );
+    const [message] = (await once(worker, "message")) as [unknown];
+    await once(worker, "exit");
+    PCRE2.releaseShared(id);
+
+    expect(message).toStrictEqual({
+      source: "a(b+)c",
+      flags: "g",
+      matches: ["abbc", "abc"],
+    });
+  });
+});
+
+describe.concurrent("memoryUsage", () => {
+  test("instance breakdown", ({ expect }) => {
+    const re = pcre2`a+b`;
+    const usage = re.memoryUsage();
+    expect(usage.pattern).toBe(6);
+    expect(usage.code).toBeGreaterThan(0);
+    expect(usage.matchData).toBeGreaterThan(0);
+    expect(usage.total).toBe(
+      usage.pattern + usage.code + usage.jit + usage.matchData + usage.heapframes + usage.matchCache
+    );
+
+    re.test("aaab");
+    expect(re.memoryUsage().jit).toBeGreaterThanOrEqual(0);
+  });
+
+  test("totals track allocations", ({ expect }) => {
+    const before = PCRE2.memoryUsage();
+    const patterns = Array.from({ length: 100 }, (_, i) => new PCRE2(`foo${i}(bar|baz)+`));
+    const after = PCRE2.memoryUsage();
+    expect(after.allocated).toBeGreaterThan(before.allocated);
+    expect(after.total).toBe(after.allocated + after.jit);
+    expect(patterns).toHaveLength(100);
+  });
+});
+
+describe.concurrent("match data options", () => {
+  test("pooled match data", ({ expect }) => {
+    const re = new PCRE2("a(b+)", "g", { pooledMatchData: true });
+    expect(re.memoryUsage().matchData).toBe(0);
+    const input = "abbxab";
+    expect(re.exec(input)).toStrictEqual(
+      createMatchArray(["abb", "bb"], { index: 0, input })
+    );
+    re.lastIndex = 0;
+    expect(input.match(re)).toStrictEqual(["abb", "ab"]);
+    expect(input.replace(re, "[$1]")).toBe("[bb]x[b]");
+    expect(re.memoryUsage().matchData).toBe(0);
+  });
+
+  test("pooled match data with reentrant calls", ({ expect }) => {
+    const re = new PCRE2("a+", "g", { pooledMatchData: true });
+    const result = "aa-a".replace(re, (m) => String(re.test(m)));
+    expect(result).toBe("true-false");
+  });
+
+  test("heap frames limit", ({ expect }) => {
+    const re = new PCRE2("(a|b)*c", "", { heapFramesLimit: 1 });
+    expect(re.test("ab".repeat(10000) + "c")).toBe(true);
+    expect(re.memoryUsage().heapframes).toBe(0);
+    expect(re.test("abc")).toBe(true);
+  });
+
+  test("invalid heap frames limit", ({ expect }) => {
+    for (const value of [-1, 0.5, NaN, Infinity]) {
+      expect(() => new PCRE2("a", "", { heapFramesLimit: value })).toThrow(RangeError);
+    }
+  });
+
+  test("inherited by copies", ({ expect }) => {
+    const re = new PCRE2("a", "g", { pooledMatchData: true });
+    expect("a,a".split(re)).toStrictEqual(["", ",", ""]);
+    expect([..."aa".matchAll(re)].map((m) => m.index)).toStrictEqual([0, 1]);
+  });
+});
+
+describe.concurrent("match cache", () => {
+  test("repeated subjects hit the cache", ({ expect }) => {
+    const re = new PCRE2("(?<key>\\w+)=(?<value>\\d+)?", "", { matchCache: 2 });
+    const reference = new PCRE2("(?<key>\\w+)=(?<value>\\d+)?");
+    const subjects = ["a=1", "b=", "a=1", "none", "b=", "c=3", "a=1"];
+    for (const subject of subjects) {
+      expect(re.exec(subject)).toStrictEqual(reference.exec(subject));
+      expect(re.test(subject)).toBe(reference.test(subject));
+    }
+    expect(re.matchCache).toStrictEqual({
+      capacity: 2,
+      size: 2,
+      hits: 8,
+      misses: 6,
+      bypassed: 0,
+      hitRate: 8 / 14,
+    });
+    expect(re.memoryUsage().matchCache).toBeGreaterThan(0);
+    expect(new PCRE2(re).matchCache?.size).toBe(0);
+    expect(reference.matchCache).toBeUndefined();
+  });
+
+  test("keyed by lastIndex", ({ expect }) => {
+    const re = new PCRE2("\\d", "g", { matchCache: 10 });
+    expect("1a2b3".match(re)).toStrictEqual(["1", "2", "3"]);
+    expect("1a2b3".match(re)).toStrictEqual(["1", "2", "3"]);
+    expect(re.matchCache?.hits).toBe(4);
+
+    const sticky = new PCRE2("a", "y", { matchCache: 10 });
+    expect(sticky.test("ba")).toBe(false);
+    sticky.lastIndex = 1;
+    expect(sticky.test("ba")).toBe(true);
+    expect(sticky.matchCache?.misses).toBe(2);
+  });
+
+  test("long subjects bypass the cache", ({ expect }) => {
+    const re = new PCRE2("b", "", { matchCache: 10, matchCacheMaxSubjectLength: 4 });
+    expect(re.test("abcd")).toBe(true);
+    expect(re.test("abcde")).toBe(true);
+    expect(re.test("abcde")).toBe(true);
+    expect(re.matchCache).toMatchObject({ size: 1, misses: 1, bypassed: 2 });
+  });
+
+  test("split bypasses the cache", ({ expect }) => {
+    const re = new PCRE2(",", "", { matchCache: 10 });
+    expect(re.test("a,b")).toBe(true);
+    const before = re.matchCache;
+    expect("a,b,c".split(re)).toStrictEqual(["a", "b", "c"]);
+    expect("a,b,c".split(re)).toStrictEqual(["a", "b", "c"]);
+    expect(re.matchCache).toStrictEqual(before);
+  });
+
+  test("matchAll shares the cache", ({ expect }) => {
+    const re = new PCRE2("\\d", "g", { matchCache: 10 });
+    expect([..."1a2".matchAll(re)].map((m) => m[0])).toStrictEqual(["1", "2"]);
+    expect([..."1a2".matchAll(re)].map((m) => m[0])).toStrictEqual(["1", "2"]);
+    expect(re.matchCache).toMatchObject({ size: 3, hits: 3, misses: 3 });
+  });
+
+  test("invalid sizes", ({ expect }) => {
+    for (const value of [-1, 1.5, NaN, 2 ** 32]) {
+      expect(() => new PCRE2("a", "", { matchCache: value })).toThrow(RangeError);
+      expect(() => new PCRE2("a", "", { matchCacheMaxSubjectLength: value })).toThrow(RangeError);
+    }
+  });
+});
+
+describe.concurrent("stats", () => {
+  test("disabled by default", ({ expect }) => {
+    const re = pcre2`abc`;
+    expect(re.stats).toBeUndefined();
+  });
+
+  test("counts calls", ({ expect }) => {
+    const re = new PCRE2("a(b)c", "", { stats: true, statsSampleInterval: 1 });
+    re.test("abc");
+    re.test("xyz");
+    re.exec("xxabc");
+    "abcabc".replace(re, "x");
+
+    const stats = re.stats!;
+    expect(stats.source).toBe("a(b)c");
+    expect(stats.calls).toBe(4);
+    expect(stats.matches).toBe(3);
+    expect(stats.noMatches).toBe(1);
+    expect(stats.errors).toBe(0);
+    expect(stats.sampledCalls).toBe(4);
+    expect(stats.bytesScanned).toBe((3 + 3 + 5 + 6) * 2);
+    expect(stats.maxTime).toBeLessThanOrEqual(stats.sampledTime);
+  });
+
+  test("sampled timing", ({ expect }) => {
+    const re = new PCRE2("abc", "", { stats: true, statsSampleInterval: 4 });
+    for (let i = 0; i < 8; i++) {
+      re.test("abc");
+    }
+    expect(re.stats!.calls).toBe(8);
+    expect(re.stats!.sampledCalls).toBe(2);
+  });
+
+  test("invalid sample interval", ({ expect }) => {
+    for (const statsSampleInterval of [0, -1, 0.5, NaN, 2 ** 32]) {
+      expect(() => new PCRE2("abc", "", { stats: true, statsSampleInterval })).toThrow(RangeError);
+    }
+  });
+
+  test("split is attributed to the pattern", ({ expect }) => {
+    const re = new PCRE2(",", "", { stats: true });
+    expect("a,b,c".split(re)).toStrictEqual(["a", "b", "c"]);
+    expect(re.stats!.matches).toBe(2);
+  });
+
+  test("getStats", ({ expect }) => {
+    const re = new PCRE2("getStats-[0-9]+", "g", { stats: true });
+    re.test("getStats-1");
+    const stats = PCRE2.getStats().find((s) => s.source === "getStats-[0-9]+");
+    expect(stats).toMatchObject({ flags: "g", calls: 1, matches: 1 });
+  });
+});
+
+describe.concurrent("profiling", () => {
+  test("reports visits and backtracks per item", ({ expect }) => {
+    const re = pcre2`(a+)+b`;
+    re.startProfiling();
+    expect(re.test("aaaaaaacb")).toBe(false);
+    const report = re.stopProfiling()!;
+
+    expect(report.calls).toBe(1);
+    expect(report.attempts).toBeGreaterThan(0);
+    const items = new Map(report.items.map((item) => [item.item, item]));
+    expect(items.get("a")!.offset).toBe(1);
+    expect(items.get("b")!.offset).toBe(5);
+    expect(items.get("b")!.backtracks).toBeGreaterThan(100);
+  });
+
+  test("matching results are unchanged", ({ expect }) => {
+    const re = pcre2("g")`(\w)(\d)`;
+    re.startProfiling();
+    const input = "a1 b2 c3";
+    expect(input.match(re)).toStrictEqual(["a1", "b2", "c3"]);
+    expect(input.replace(re, "$2$1")).toBe("1a 2b 3c");
+    expect(re.stopProfiling()!.calls).toBeGreaterThan(0);
+  });
+
+  test("split is profiled", ({ expect }) => {
+    const re = pcre2`\d`;
+    re.startProfiling();
+    expect("a1b2c".split(re)).toStrictEqual(["a", "b", "c"]);
+    expect(re.stopProfiling()!.calls).toBe(5);
+  });
+
+  test("keeps the match limit", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "", { redos: "limit" });
+    re.startProfiling();
+    expect(() => re.test("a".repeat(40) + "cb")).toThrow(/match limit exceeded/);
+    expect(re.stopProfiling()!.calls).toBe(1);
+  });
+
+  test("stop without start", ({ expect }) => {
+    const re = pcre2`abc`;
+    expect(re.stopProfiling()).toBeUndefined();
+  });
+});
+
+describe.concurrent("literal patterns", () => {
+  const long = "x".repeat(100) + "needle" + "y".repeat(100) + "NEEDLE" + "z".repeat(3);
+
+  test.for([
+    ["needle", ""],
+    ["needle", "g"],
+    ["needle", "gi"],
+    ["a\\.b\\/c", "g"],
+    ["é", "g"],
+  ])("%s with flags %s behaves like RegExp", ([pattern, flags], { expect }) => {
+    for (const input of [long, "a.b/c a.b/c axb/c", "É é"]) {
+      expect(input.match(new PCRE2(pattern, flags))).toStrictEqual(input.match(new RegExp(pattern, flags)));
+      expect(input.replace(new PCRE2(pattern, flags), "[]")).toBe(input.replace(new RegExp(pattern, flags), "[]"));
+      expect(input.replace(new PCRE2(pattern, flags), "<$&>")).toBe(input.replace(new RegExp(pattern, flags), "<$&>"));
+      expect(input.split(new PCRE2(pattern, flags))).toStrictEqual(input.split(new RegExp(pattern, flags)));
+      expect(input.search(new PCRE2(pattern, flags))).toBe(input.search(new RegExp(pattern, flags)));
+    }
+  });
+
+  test("lastIndex", ({ expect }) => {
+    const re = new PCRE2("needle", "g");
+    expect(re.test(long)).toBe(true);
+    expect(re.lastIndex).toBe(106);
+    expect(re.test(long)).toBe(false);
+    expect(re.lastIndex).toBe(0);
+  });
+
+  test("sticky", ({ expect }) => {
+    const re = new PCRE2("ab", "y");
+    expect(re.exec("abab")?.index).toBe(0);
+    expect(re.exec("abab")?.index).toBe(2);
+    expect(re.exec("abab")).toBeNull();
+  });
+});
+
+describe.concurrent("analyze", () => {
+  test("nested quantifier", ({ expect }) => {
+    expect(PCRE2.analyze("^(\\w+\\s?)+$")).toStrictEqual({
+      risk: "exponential",
+      issues: [{ risk: "exponential", kind: "nestedQuantifier", start: 1, end: 10, source: "(\\w+\\s?)+" }],
+    });
+  });
+
+  test("overlapping alternation", ({ expect }) => {
+    expect(PCRE2.analyze("(a|a)*b").issues).toMatchObject([{ kind: "overlappingAlternation", start: 0, end: 6 }]);
+    expect(PCRE2.analyze("(A|a)+b", "i").risk).toBe("exponential");
+    expect(PCRE2.analyze("(A|a)+b").risk).toBe("none");
+  });
+
+  test("adjacent quantifiers", ({ expect }) => {
+    expect(PCRE2.analyze("x\\d+\\s*\\d+").issues).toMatchObject([
+      { risk: "polynomial", kind: "adjacentQuantifiers", source: "\\d+\\s*\\d+" },
+    ]);
+  });
+
+  test("safe patterns", ({ expect }) => {
+    for (const pattern of ["(a+b)+", "(?>a+)+b", "(a++)+b", "(ab|a)+c", "\\d+\\.\\d+", "[a-z]+@[a-z]+\\.com"]) {
+      expect(PCRE2.analyze(pattern).risk).toBe("none");
+    }
+  });
+
+  test("invalid pattern", ({ expect }) => {
+    expect(() => PCRE2.analyze("(a")).toThrow(/compilation failed/);
+  });
+
+  test("redos: reject", ({ expect }) => {
+    expect(() => new PCRE2("(a+)+b", "", { redos: "reject" })).toThrow(
+      "PCRE2 pattern has exponential backtracking risk at offset 0"
+    );
+    expect(new PCRE2("a+b", "", { redos: "reject" }).test("aab")).toBe(true);
+  });
+
+  test("redos: limit", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "", { redos: "limit" });
+    expect(re.test("aab")).toBe(true);
+    expect(() => re.test("a".repeat(40) + "cb")).toThrow(/match limit exceeded/);
+  });
+
+  test("matchLimit", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "", { matchLimit: 1000 });
+    expect(() => re.test("a".repeat(40) + "cb")).toThrow(/match limit exceeded/);
+  });
+
+  test("invalid matchLimit", ({ expect }) => {
+    for (const matchLimit of [-1, 1.5, NaN, 2 ** 32]) {
+      expect(() => new PCRE2("(a+)+b", "", { matchLimit })).toThrow(RangeError);
+      expect(() => new PCRE2("(a+)+b", "", { redos: "limit", matchLimit })).toThrow(RangeError);
+    }
+  });
+});
+
+describe.concurrent("timeouts", () => {
+  // Without a match limit, so that only the deadline stops matching
+  const options = { matchLimit: 2 ** 32 - 1 };
+  const input = "a".repeat(40) + "cb";
+
+  test("exec and test", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "", options);
+    expect(() => re.test(input, { timeoutMs: 20 })).toThrow(
+      expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT", message: "PCRE2 match timed out after 20ms" })
+    );
+    expect(() => re.exec(input, { timeoutMs: 20 })).toThrow(expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" }));
+    expect(re.exec("aab", { timeoutMs: 20 })?.[0]).toBe("aab");
+  });
+
+  test("invalid timeouts", ({ expect }) => {
+    const re = new PCRE2("a");
+    for (const timeoutMs of [NaN, -1]) {
+      expect(() => new PCRE2("a", "", { timeoutMs })).toThrow(RangeError);
+      expect(() => re.test("a", { timeoutMs })).toThrow(RangeError);
+    }
+    expect(new PCRE2("a", "", { timeoutMs: Infinity }).test("a")).toBe(true);
+    expect(re.test("a", { timeoutMs: Infinity })).toBe(true);
+    expect(re.test("a", { timeoutMs: 1e300 })).toBe(true);
+  });
+
+  test("constructor option", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "g", { ...options, timeoutMs: 20 });
+    expect(() => input.match(re)).toThrow(expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" }));
+    re.lastIndex = 3;
+    expect(() => input.search(re)).toThrow(expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" }));
+    expect(re.lastIndex).toBe(3);
+    expect("xaabx".replace(re, "-")).toBe("x-x");
+  });
+
+  test("replace and split", ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "g", options);
+    expect(() => re[Symbol.replace](input, "x", { timeoutMs: 20 })).toThrow(
+      expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" })
+    );
+    expect(() => re[Symbol.replace](input, () => "x", { timeoutMs: 20 })).toThrow(
+      expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" })
+    );
+    expect(() => re[Symbol.split](input, undefined, { timeoutMs: 20 })).toThrow(
+      expect.objectContaining({ code: "ERR_PCRE2_TIMEOUT" })
+    );
+  });
+
+  test("filterParallel with an aborted signal", async ({ expect }) => {
+    const re = new PCRE2("abc");
+    await expect(re.filterParallel(["abc"], { signal: AbortSignal.abort(new Error("stop")) })).rejects.toThrow("stop");
+  });
+
+  test("filterParallel aborted while matching", async ({ expect }) => {
+    const re = new PCRE2("(a+)+b", "", options);
+    const controller = new AbortController();
+    const promise = re.filterParallel([input, input], { signal: controller.signal });
+    setTimeout(() => controller.abort(new Error("stop")), 20);
+    await expect(promise).rejects.toThrow("stop");
+  });
+
+  test("filterParallel with a signal", async ({ expect }) => {
+    const re = new PCRE2("ab+c");
+    const controller = new AbortController();
+    expect(await re.filterParallel(["abc", "ac", "abbc"], { signal: controller.signal })).toStrictEqual(
+      new Uint32Array([0, 2])
+    );
+  });
+});
+
+describe.concurrent("compileMany", () => {
+  test("compiles patterns in order", async ({ expect }) => {
+    const patterns = Array.from({ length: 20 }, (_, i) => `a{${i}}b`);
+    const result = await PCRE2.compileMany(patterns, { threads: 3 });
+    expect(result).toHaveLength(20);
+    result.forEach((re, i) => {
+      expect(re).toBeInstanceOf(PCRE2);
+      expect((re as PCRE2).source).toBe(patterns[i]);
+      expect((re as PCRE2).test("a".repeat(i) + "b")).toBe(true);
+    });
+  });
+
+  test("flags and options", async ({ expect }) => {
+    const [re, shared] = (await PCRE2.compileMany([
+      { pattern: "^abc$", flags: "im" },
+      { pattern: "ab+c", options: { stats: true } },
+    ])) as PCRE2[];
+    expect(re.flags).toBe("im");
+    expect(re.test("x\nABC")).toBe(true);
+    expect(shared.test("abbc")).toBe(true);
+    expect(shared.stats?.calls).toBe(1);
+  });
+
+  test("empty array", async ({ expect }) => {
+    expect(await PCRE2.compileMany([])).toStrictEqual([]);
+  });
+
+  test("errors are per entry", async ({ expect }) => {
+    const result = await PCRE2.compileMany([
+      "a(b",
+      { pattern: "abc", flags: "q" },
+      { pattern: "(a+)+b", options: { redos: "reject" } },
+      "abc",
+    ]);
+    expect(result[0]).toBeInstanceOf(Error);
+    expect(result[0]).toMatchObject({ offset: 3 });
+    expect((result[0] as Error).message).toMatch("PCRE2 compilation failed at offset 3");
+    expect((result[1] as Error).message).toBe("Invalid flags supplied to PCRE2 constructor 'q'");
+    expect(result[2]).toBeInstanceOf(Error);
+    expect(result[3]).toBeInstanceOf(PCRE2);
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => PCRE2.compileMany("abc" as never)).toThrow("Expected an array of patterns");
+    for (const threads of [0, -1, 1.5, NaN]) {
+      expect(() => PCRE2.compileMany(["abc"], { threads })).toThrow(RangeError);
+    }
+  });
+});
+
+describe.concurrent("PCRE2RuleIndex", () => {
+  test("matches rules", ({ expect }) => {
+    const index = new PCRE2RuleIndex(["error: \\d+", /warn(ing)?/i, new PCRE2("^\\d+$"), "time(out|d out)"]);
+    expect(index.size).toBe(4);
+    expect(index.alwaysChecked).toBe(1);
+    expect(index.match("error: 42")).toStrictEqual(new Uint32Array([0]));
+    expect(index.match("WARNING: timed out")).toStrictEqual(new Uint32Array([1, 3]));
+    expect(index.match("1234")).toStrictEqual(new Uint32Array([2]));
+    expect(index.match("nothing")).toStrictEqual(new Uint32Array([]));
+  });
+
+  test("candidates", ({ expect }) => {
+    const index = new PCRE2RuleIndex(["abc\\d", "x(yz|wv)", "[a-z]+"]);
+    expect(index.candidates("abcx")).toStrictEqual(new Uint32Array([0, 2]));
+    expect(index.candidates("ABCXWV")).toStrictEqual(new Uint32Array([0, 1, 2]));
+    expect(index.candidates("")).toStrictEqual(new Uint32Array([2]));
+    expect(index.match("abcx")).toStrictEqual(new Uint32Array([2]));
+  });
+
+  test("agrees with test", ({ expect }) => {
+    const rules = ["ab+c", "a(bc|de)f", "(foo)?barbaz", "x{3}y", "(?:ab|cd)e", "a.c", "\\bword\\b", "k+s"].map(
+      (pattern, i) => new PCRE2(pattern, i % 2 ? "i" : "")
+    );
+    const index = new PCRE2RuleIndex(rules);
+    const subjects = ["abbbc", "ADEF", "barbaz", "xxxy", "CDE", "abc", "a word", "KKS", "nothing", "aBc"];
+    for (const subject of subjects) {
+      const expected = rules.flatMap((re, i) => (re.test(subject) ? [i] : []));
+      expect(index.match(subject)).toStrictEqual(new Uint32Array(expected));
+    }
+  });
+
+  test("quantifier braces with spaces and named characters", ({ expect }) => {
+    const rules = [new PCRE2("xa{ 2 }b"), new PCRE2("ya{2, 3}c"), new PCRE2("x\\N{U+41}y", "u")];
+    const index = new PCRE2RuleIndex(rules);
+    for (const subject of ["xaab", "yaaac", "xAy", "xa{ 2 }b", "nothing"]) {
+      const expected = rules.flatMap((re, i) => (re.test(subject) ? [i] : []));
+      expect(index.match(subject)).toStrictEqual(new Uint32Array(expected));
+    }
+    expect(index.match("xaab")).toStrictEqual(new Uint32Array([0]));
+    expect(index.match("xAy")).toStrictEqual(new Uint32Array([2]));
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => new PCRE2RuleIndex("abc" as never)).toThrow("Expected an array of patterns");
+    expect(() => new PCRE2RuleIndex(["a(b"])).toThrow("PCRE2 compilation failed");
+  });
+});
+
+describe.concurrent("PCRE2Document", () => {
+  function fullScan(pattern: string, flags: string, text: string) {
+    return [...text.matchAll(new PCRE2(pattern, flags + "g"))].map((match) => ({
+      start: match.index,
+      end: match.index + match[0].length,
+    }));
+  }
+
+  test("matches", ({ expect }) => {
+    const doc = new PCRE2Document(new PCRE2("b+", "g"), "abbcb");
+    expect(doc.text).toBe("abbcb");
+    expect(doc.matches).toStrictEqual([
+      { start: 1, end: 3 },
+      { start: 4, end: 5 },
+    ]);
+  });
+
+  test("edit returns the change", ({ expect }) => {
+    const doc = new PCRE2Document("\\d+", "a1 b22 c333 d4444");
+    expect(doc.edit(4, 1, "")).toStrictEqual({
+      index: 1,
+      removed: [{ start: 4, end: 6 }],
+      added: [{ start: 4, end: 5 }],
+    });
+    expect(doc.text).toBe("a1 b2 c333 d4444");
+    expect(doc.matches).toStrictEqual(fullScan("\\d+", "", doc.text));
+    expect(doc.edit(0, 0, "x")).toStrictEqual({ index: 0, removed: [], added: [] });
+    expect(doc.matches[0]).toStrictEqual({ start: 2, end: 3 });
+  });
+
+  test.for([
+    ["\\d+", ""],
+    ["(?<=a)b", ""],
+    ["\\bab\\b", ""],
+    ["^a.*$", "m"],
+    ["a(?=b{2})", ""],
+    ["b*", ""],
+    ["(?:ab|a)c?", "i"],
+  ])("random edits agree with a full rescan: %s", ([pattern, flags], { expect }) => {
+    let seed = 1;
+    const random = (n: number) => {
+      seed = (seed * 1103515245 + 12345) % 2147483648;
+      return seed % n;
+    };
+    const alphabet = "aAbc1 \n";
+    const randomText = (length: number) =>
+      Array.from({ length }, () => alphabet[random(alphabet.length)]).join("");
+
+    const doc = new PCRE2Document(new PCRE2(pattern, flags), randomText(200));
+    for (let i = 0; i < 200; i++) {
+      const previous = doc.matches;
+      const offset = random(doc.text.length + 1);
+      const deleteCount = random(4);
+      const insert = randomText(random(4));
+      const { index, removed, added } = doc.edit(offset, deleteCount, insert);
+
+      expect(doc.matches).toStrictEqual(fullScan(pattern, flags, doc.text));
+
+      expect(previous.slice(index, index + removed.length)).toStrictEqual(removed);
+      expect(doc.matches.slice(index, index + added.length)).toStrictEqual(added);
+      expect(doc.matches.length - added.length).toBe(previous.length - removed.length);
+    }
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => new PCRE2Document("a(b", "")).toThrow("PCRE2 compilation failed");
+  });
+});
+
+describe.concurrent("PCRE2Lexer", () => {
+  const rules = [
+    { name: "space", pattern: "\\s+", skip: true },
+    { name: "keyword", pattern: "(?:let|if)\\b" },
+    { name: "ident", pattern: "[a-z]\\w*" },
+    { name: "number", pattern: "\\d+" },
+    { name: "string", pattern: "(['\"]).*?\\1" },
+    { name: "op", pattern: "[=+]" },
+  ];
+
+  function tokens(lexer: PCRE2Lexer, input: string) {
+    const { rules, starts, ends } = lexer.tokenize(input);
+    return Array.from(rules, (rule, i) => [
+      rule === -1 ? "error" : lexer.names[rule],
+      input.slice(starts[i], ends[i]),
+    ]);
+  }
+
+  test("tokenizes with the first rule that matches", ({ expect }) => {
+    const lexer = new PCRE2Lexer(rules);
+    expect(lexer.names).toStrictEqual(["space", "keyword", "ident", "number", "string", "op"]);
+    expect(tokens(lexer, "let iffy = x1 + 42 'a b'")).toStrictEqual([
+      ["keyword", "let"],
+      ["ident", "iffy"],
+      ["op", "="],
+      ["ident", "x1"],
+      ["op", "+"],
+      ["number", "42"],
+      ["string", "'a b'"],
+    ]);
+    const { rules: ids, starts, ends } = lexer.tokenize("");
+    expect([ids, starts, ends]).toStrictEqual([new Int32Array(), new Int32Array(), new Int32Array()]);
+  });
+
+  test("rules keep their own groups and flags apply to all of them", ({ expect }) => {
+    const lexer = new PCRE2Lexer(
+      [
+        { name: "word", pattern: "(?<c>[a-z])\\k<c>*" },
+        { name: "digits", pattern: "(?<c>\\d)\\k<c>*  # runs" },
+        { name: "other", pattern: "\\Q." },
+      ],
+      "ix",
+    );
+    expect(tokens(lexer, "aAb11.2")).toStrictEqual([
+      ["word", "aA"],
+      ["word", "b"],
+      ["digits", "11"],
+      ["other", "."],
+      ["digits", "2"],
+    ]);
+  });
+
+  test("empty matches don't count", ({ expect }) => {
+    const lexer = new PCRE2Lexer([
+      { name: "maybe", pattern: "a*" },
+      { name: "b", pattern: "b" },
+    ]);
+    expect(tokens(lexer, "aab")).toStrictEqual([
+      ["maybe", "aa"],
+      ["b", "b"],
+    ]);
+  });
+
+  test("unmatched input", ({ expect }) => {
+    expect(() => new PCRE2Lexer(rules).tokenize("x = #")).toThrow(
+      expect.objectContaining({ message: "No lexer rule matches at offset 4", offset: 4 }),
+    );
+
+    const lexer = new PCRE2Lexer(rules, "u", { errorRecovery: true });
+    expect(tokens(lexer, "x ##\u{1F600} y #")).toStrictEqual([
+      ["ident", "x"],
+      ["error", "##\u{1F600}"],
+      ["ident", "y"],
+      ["error", "#"],
+    ]);
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => new PCRE2Lexer("abc" as never)).toThrow("Expected an array of rules");
+    expect(() => new PCRE2Lexer([])).toThrow("Expected at least one rule");
+    expect(() => new PCRE2Lexer([{ name: "open", pattern: "a(b" }])).toThrow(
+      "Invalid lexer rule 'open': PCRE2 compilation failed",
+    );
+    expect(() => new PCRE2Lexer([{ name: "close", pattern: "a)|(b" }])).toThrow("Invalid lexer rule 'close'");
+  });
+
+  test.for([
+    ["(*MARK:x)a", "(*MARK) is not supported"],
+    ["(*:x)a", "(*:NAME) is not supported"],
+    ["a(*ACCEPT)b", "(*ACCEPT) is not supported"],
+    ["a(*COMMIT)b", "(*COMMIT) is not supported"],
+    ["a(*PRUNE)b", "(*PRUNE) is not supported"],
+    ["a(*SKIP)b", "(*SKIP) is not supported"],
+    ["(*UTF)a", "(*UTF) is not supported"],
+    ["\\((?R)?\\)", "recursion and subroutine calls are not supported"],
+    ["(a)(?1)", "recursion and subroutine calls are not supported"],
+    ["(?<x>a)(?&x)", "recursion and subroutine calls are not supported"],
+    ["(a)\\g<1>", "recursion and subroutine calls are not supported"],
+  ])("rejects rules using %s", ([pattern, message], { expect }) => {
+    expect(() => new PCRE2Lexer([{ name: "word", pattern: "\\w+" }, { name: "bad", pattern }])).toThrow(
+      `Invalid lexer rule 'bad': ${message}`,
+    );
+  });
+
+  test("allows look-alikes of unsupported constructs", ({ expect }) => {
+    const lexer = new PCRE2Lexer([
+      { name: "quoted", pattern: "\\Q(*MARK)\\E" },
+      { name: "class", pattern: "[(?R)*]+" },
+      { name: "fail", pattern: "x(*FAIL)|y" },
+      { name: "backref", pattern: "(z)\\g{1}" },
+    ]);
+    expect(tokens(lexer, "(*MARK)(?R)yzz")).toStrictEqual([
+      ["quoted", "(*MARK)"],
+      ["class", "(?R)"],
+      ["fail", "y"],
+      ["backref", "zz"],
+    ]);
+  });
+
+  test("rules naming the same group differently", ({ expect }) => {
+    expect(() =>
+      new PCRE2Lexer([
+        { name: "number", pattern: "(?<digits>\\d+)" },
+        { name: "word", pattern: "(?<letters>[a-z]+)" },
+      ]),
+    ).toThrow("Lexer rules 'number' and 'word' give different names to capture group 1");
+    expect(
+      tokens(
+        new PCRE2Lexer([
+          { name: "number", pattern: "(?<text>\\d+)" },
+          { name: "word", pattern: "(?<text>[a-z]+)|(x)(?<other>y)" },
+        ]),
+        "12ab",
+      ),
+    ).toStrictEqual([
+      ["number", "12"],
+      ["word", "ab"],
+    ]);
+  });
+});
+
+describe.concurrent("external strings", () => {
+  const long = "a".repeat(3000) + "," + "b".repeat(10) + "," + "c".repeat(5000);
+
+  test.for([
+    ["(?<first>[a-c]+),", ""],
+    ["[a-c]+", "g"],
+    [",", ""],
+    ["(,)", "g"],
+  ])("%s with flags %s behaves like RegExp", ([pattern, flags], { expect }) => {
+    const re = new PCRE2(pattern, flags, { externalStrings: true });
+    expect(long.match(re)).toStrictEqual(long.match(new RegExp(pattern, flags)));
+    expect(long.split(re)).toStrictEqual(long.split(new RegExp(pattern, flags)));
+    expect([...long.matchAll(new PCRE2(pattern, "g" + flags.replace("g", ""), { externalStrings: true }))]).toStrictEqual([
+      ...long.matchAll(new RegExp(pattern, "g" + flags.replace("g", ""))),
+    ]);
+  });
+
+  test("long captures", ({ expect }) => {
+    const match = new PCRE2("b+(c+)", "", { externalStrings: true }).exec(long);
+    expect(match?.[1]).toBe("c".repeat(5000));
+    expect(match?.[1].length).toBe(5000);
+  });
+});
+
+describe("perf map", () => {
+  test("JIT code of patterns", ({ expect, onTestFinished }) => {
+    const path = join(tmpdir(), `pcre2-perf-${process.pid}.map`);
+    onTestFinished(() => {
+      PCRE2.disablePerfMap();
+      rmSync(path, { force: true });
+    });
+
+    expect(PCRE2.enablePerfMap(path)).toBe(path);
+    expect(new PCRE2("perf(map)+\\n", "g").test("perfmapmap\n")).toBe(true);
+    expect(readFileSync(path, "utf8")).toMatch(/^[0-9a-f]+ [0-9a-f]+ pcre2:\/perf\(map\)\+\\n\/g$/m);
+
+    PCRE2.disablePerfMap();
+    const size = readFileSync(path, "utf8").length;
+    expect(new PCRE2("perf(map)+", "g").test("perfmap")).toBe(true);
+    expect(readFileSync(path, "utf8").length).toBe(size);
+  });
+});
+
+describe("recording", () => {
+  function record(options: Parameters<typeof PCRE2.startRecording>[1], fn: () => void) {
+    const path = join(tmpdir(), `pcre2-trace-${process.pid}.bin`);
+    try {
+      PCRE2.startRecording(path, options);
+      fn();
+      const records = PCRE2.stopRecording();
+      const trace = readTrace(readFileSync(path));
+      if (trace.records.length !== records) {
+        throw new Error(`Expected ${records} records, read ${trace.records.length}`);
+      }
+      return trace;
+    } finally {
+      PCRE2.stopRecording();
+      rmSync(path, { force: true });
+    }
+  }
+
+  test("records compilations and calls", ({ expect }) => {
+    const trace = record({ subjects: "full" }, () => {
+      const re = new PCRE2("rec(or)+d", "i");
+      re.test("a RECORD");
+      "x record y".replace(re, "[$&]");
+    });
+
+    const [pattern] = [...trace.patterns.values()].filter((p) => p.pattern === "rec(or)+d");
+    expect(pattern.flags).toBe("i");
+    const records = trace.records.filter((r) => r.patternId === pattern.id);
+    expect(records.map((r) => r.type)).toStrictEqual(["compile", "match", "match"]);
+    expect(records[1]).toMatchObject({ kind: "match", subject: "a RECORD", startOffset: 0, returnCode: 2 });
+    expect(records[2]).toMatchObject({ kind: "substitute", subject: "x record y", replacement: "[$&]", returnCode: 1 });
+  });
+
+  test("subjects modes and sampling", ({ expect }) => {
+    const run = () => {
+      const re = new PCRE2("sampl(e)");
+      for (let i = 0; i < 10; i++) {
+        re.exec("Sample 42 sample \u00e9");
+      }
+    };
+
+    const redacted = record({ subjects: "redacted" }, run);
+    const calls = (trace: typeof redacted) =>
+      trace.records.filter((r) => r.type === "match" && trace.patterns.get(r.patternId)?.pattern === "sampl(e)");
+    expect(calls(redacted)[0]).toMatchObject({ subjectLength: 18, subject: "Aaaaaa 00 aaaaaa x" });
+
+    const lengthOnly = record({ sampleInterval: 5 }, run);
+    expect(lengthOnly.subjects).toBe("length");
+    expect(calls(lengthOnly).length).toBe(2);
+    expect(calls(lengthOnly).some((r) => "subject" in r)).toBe(false);
+  });
+
+  test("not recording", ({ expect }) => {
+    expect(PCRE2.stopRecording()).toBeUndefined();
+    expect(() => PCRE2.startRecording(join(tmpdir(), "missing-dir", "trace.bin"))).toThrow("Failed to open trace");
+    expect(() => PCRE2.startRecording("x", { subjects: "all" as never })).toThrow("Invalid subjects option 'all'");
+    for (const sampleInterval of [0, -1, 1.5, NaN]) {
+      expect(() => PCRE2.startRecording("x", { sampleInterval })).toThrow(RangeError);
+    }
+  });
+
+  test.skipIf(process.platform !== "linux")("write failures", ({ expect }) => {
+    PCRE2.startRecording("/dev/full", { subjects: "full" });
+    const re = new PCRE2("full");
+    for (let i = 0; i < 100; i++) {
+      re.test("full".repeat(1000));
+    }
+    expect(() => PCRE2.stopRecording()).toThrow("Failed to write the trace");
+    expect(PCRE2.stopRecording()).toBeUndefined();
+  });
+});
+
+describe.concurrent("globs", () => {
+  const paths = ["a.ts", "src/a.ts", "src/lib/b.ts", "src/c.js", "test/d.ts", "*.ts", "A.TS"];
+
+  test.for([
+    ["*.ts", {}, ["a.ts", "*.ts"]],
+    ["src/**/*.ts", {}, ["src/a.ts", "src/lib/b.ts"]],
+    ["src/*.ts", { wildSeparator: true }, ["src/a.ts", "src/lib/b.ts"]],
+    ["**/*.ts", { starStar: false }, ["src/a.ts", "test/d.ts"]],
+    ["\\*.ts", {}, ["*.ts"]],
+    ["`*.ts", { escape: "`" }, ["*.ts"]],
+    ["*.ts", { flags: "i" }, ["a.ts", "*.ts", "A.TS"]],
+    ["src\\*.ts", { separator: "\\", escape: null }, []],
+    ["?.[jt]s", {}, ["a.ts", "*.ts"]],
+  ] as const)("%s with %o", ([glob, options, expected], { expect }) => {
+    const re = PCRE2.fromGlob(glob, options);
+    expect(Array.from(re.filterPaths(paths), (i) => paths[i])).toStrictEqual(expected);
+    expect(paths.filter((path) => re.test(path))).toStrictEqual(expected);
+  });
+
+  test("POSIX", ({ expect }) => {
+    expect(PCRE2.fromPosix("^a\\(b*\\)c$").exec("abbc")?.[1]).toBe("bb");
+    expect(PCRE2.fromPosix("^a(b*)c|d+$", { extended: true }).exec("abbc")?.[1]).toBe("bb");
+  });
+
+  test("filterPaths", ({ expect }) => {
+    expect(new PCRE2("^src/").filterPaths(paths)).toStrictEqual(new Uint32Array([1, 2, 3]));
+    expect(new PCRE2("^src/", "g").filterPaths([])).toStrictEqual(new Uint32Array(0));
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => PCRE2.fromGlob("[a")).toThrow("PCRE2 pattern conversion failed at offset 2");
+    expect(() => PCRE2.fromGlob("*", { separator: "ab" })).toThrow("Invalid glob separator");
+    expect(() => PCRE2.fromGlob("*", { escape: "a" })).toThrow("Invalid glob escape");
+  });
+});
+
+describe.concurrent("extractColumns", () => {
+  const re = new PCRE2("^(?<host>\\S+) (?<status>\\d{3})(?: (?<bytes>\\d+))?$");
+  const lines = ["a.com 200 512", "b.org 404", "garbage", "c.net 500 0"];
+
+  function bit(matched: Uint8Array, i: number) {
+    return (matched[i >> 3] >> (i & 7)) & 1;
+  }
+
+  test("strings", ({ expect }) => {
+    const { length, matched, columns } = re.extractColumns(lines);
+    expect(length).toBe(4);
+    expect([0, 1, 2, 3].map((i) => bit(matched, i))).toStrictEqual([1, 1, 0, 1]);
+    expect(columns).toStrictEqual(
+      Object.assign(Object.create(null), {
+        bytes: ["512", undefined, undefined, "0"],
+        host: ["a.com", "b.org", undefined, "c.net"],
+        status: ["200", "404", undefined, "500"],
+      }),
+    );
+    for (const [i, line] of lines.entries()) {
+      const groups = re.exec(line)?.groups;
+      expect(groups?.host).toBe(columns.host[i]);
+      expect(groups?.bytes).toBe(columns.bytes[i]);
+    }
+  });
+
+  test("offsets into a string", ({ expect }) => {
+    const text = lines.join("\r\n") + "\n";
+    const { length, matched, columns } = re.extractColumns(text, { groups: ["status", "host"], offsets: true });
+    expect(length).toBe(4);
+    expect(Object.keys(columns)).toStrictEqual(["status", "host"]);
+    expect(columns.status).toStrictEqual(new Int32Array([6, 9, 21, 24, -1, -1, 41, 44]));
+    expect(Array.from(matched)).toStrictEqual([0b1011]);
+    expect(text.slice(columns.host[6], columns.host[7])).toBe("c.net");
+  });
+
+  test("duplicate names take the group that is set", ({ expect }) => {
+    const dup = new PCRE2("(?<n>\\d+)|x(?<n>[a-z]+)", "J");
+    expect(dup.extractColumns(["12", "xab", "-"]).columns.n).toStrictEqual(["12", "ab", undefined]);
+  });
+
+  test("many lines", ({ expect }) => {
+    const many = Array.from({ length: 1000 }, (_, i) => (i % 3 ? `h${i} ${100 + i}` : "-"));
+    const { matched, columns } = re.extractColumns(many.join("\n"));
+    for (const [i, line] of many.entries()) {
+      expect(bit(matched, i)).toBe(re.test(line) ? 1 : 0);
+      expect(columns.status[i]).toBe(re.exec(line)?.groups?.status);
+    }
+  });
+
+  test("invalid arguments", ({ expect }) => {
+    expect(() => re.extractColumns(1 as never)).toThrow("Expected an array of strings or a string");
+    expect(() => re.extractColumns(lines, { groups: ["nope"] })).toThrow("Unknown group name 'nope'");
+    expect(re.extractColumns([], { groups: [] })).toStrictEqual({
+      length: 0,
+      matched: new Uint8Array(0),
+      columns: Object.create(null),
+    });
+  });
+});
+
+describe("slow match tracing", () => {
+  test("publishes calls over the threshold", async ({ expect, onTestFinished }) => {
+    const events: unknown[] = [];
+    const onEvent = (event: unknown) => events.push(event);
+    subscribe("pcre2:slow-match", onEvent);
+    onTestFinished(() => {
+      PCRE2.setSlowMatchThreshold(undefined);
+      unsubscribe("pcre2:slow-match", onEvent);
+    });
+
+    const re = new PCRE2("(a+)+b", "i");
+    expect(re.test("secret aaaab")).toBe(true);
+    await Promise.resolve();
+    expect(events).toStrictEqual([]);
+
+    PCRE2.setSlowMatchThreshold(Number.MIN_VALUE);
+    expect(re.test("secret aaaab")).toBe(true);
+    expect(re[Symbol.replace]("secret aaaab", "x")).toBe("secret x");
+    expect(events).toStrictEqual([]);
+    await Promise.resolve();
+    expect(events).toStrictEqual([
+      {
+        kind: "match",
+        source: "(a+)+b",
+        flags: "i",
+        subjectLength: 12,
+        lastIndex: 0,
+        durationMs: expect.any(Number),
+        jit: true,
+        returnCode: 2,
+      },
+      expect.objectContaining({ kind: "substitute", subjectLength: 12, returnCode: 1 }),
+    ]);
+    expect(JSON.stringify(events)).not.toContain("secret");
+  });
+
+  test("follows subscriptions", async ({ expect, onTestFinished }) => {
+    const events: unknown[] = [];
+    const onEvent = (event: unknown) => events.push(event);
+    onTestFinished(() => {
+      PCRE2.setSlowMatchThreshold(undefined);
+      unsubscribe("pcre2:slow-match", onEvent);
+    });
+
+    PCRE2.setSlowMatchThreshold(Number.MIN_VALUE);
+    const re = new PCRE2("b", "g");
+    re.lastIndex = 1;
+    expect(re.test("abc")).toBe(true);
+
+    // The call above wasn't timed, so it isn't published now either
+    channel("pcre2:slow-match").subscribe(onEvent);
+    expect(re.test("abc")).toBe(false);
+    await Promise.resolve();
+    expect(events).toStrictEqual([expect.objectContaining({ kind: "match", lastIndex: 2, returnCode: -1 })]);
+
+    unsubscribe("pcre2:slow-match", onEvent);
+    expect(re.test("abc")).toBe(true);
+    await Promise.resolve();
+    expect(events).toHaveLength(1);
+  });
+});